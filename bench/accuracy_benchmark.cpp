@@ -0,0 +1,879 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <functional>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <ciso646>
+
+#include <fftw3.h>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/transport_solver.hpp"
+#include "audio_transport/tonal.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/context.hpp"
+#include "audio_transport/stream.hpp"
+#include "audio_transport/codec.hpp"
+
+/**
+ * Compares the optimised paths of the library against a copy
+ * of the original implementation on a synthetic corpus.
+ *
+ * Each path reports the SNR and largest bin error relative
+ * to the reference (spectra for analysis and interpolate,
+ * audio for synthesis, masses for grouping and transport),
+ * how much of the mass groups into the same masses, and the time
+ * taken by both. A path fails when its SNR or the fraction
+ * of mass in equal partitions falls below its threshold.
+ * Thresholds can be set on the command line:
+ *
+ *   ./accuracy_benchmark interpolate/tonal=25,0.9 analysis/pruned=150
+ *
+ * The exit status is the number of paths that failed.
+ */
+
+using namespace audio_transport;
+
+typedef std::vector<std::vector<spectral::point>> frames;
+
+double sample_rate = 22050; // samples per second
+double total_time = 1; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+double interpolation = 0.3;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+////////////////////////////////////////////
+// The original implementation, unchanged
+// apart from its namespace and warnings
+////////////////////////////////////////////
+
+namespace reference {
+
+std::vector<double> synthesis(
+    const std::vector<std::vector<spectral::point>> & points,
+    unsigned int padding,
+    unsigned int overlap) {
+
+  // Initialize the window
+  std::vector<double> window_padded(2 * (points[0].size() - 1));
+  size_t window_size = window_padded.size()/(1 + padding);
+  size_t padding_samples = (window_padded.size() - window_size)/2;
+
+  // Initialize the audio
+  // Accounting for an overlap factor of 2 * overlap
+  size_t hop_size = window_size/(2 * overlap);
+  size_t num_hops = points.size() + 2 * overlap - 1;
+  std::vector<double> audio(num_hops * hop_size, 0);
+
+  // Initialize FFT
+  fftw_complex * fft;
+  fft = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * points[0].size());
+  fftw_plan fft_plan = fftw_plan_dft_c2r_1d(
+      window_padded.size(),
+      fft,
+      window_padded.data(),
+      FFTW_MEASURE);
+
+  // Iterate over the windows
+  for (size_t w = 0; w < points.size(); w++) {
+
+    // Fill the FFT
+    for (size_t i = 0; i < points[w].size(); i++) {
+      fft[i][0] = std::real(points[w][i].value);
+      fft[i][1] = std::imag(points[w][i].value);
+    }
+
+    // Execute the plans
+    fftw_execute(fft_plan);
+
+    // Apply the weighted overlap add
+    for (size_t i = 0; i < window_size; i++) {
+      // Scale down to correct for FFT and overlap sizes
+      double value = window_padded[i + padding_samples]/(overlap * window_padded.size());
+
+      // Add it to the overlapped signal
+      audio[i + w * window_size/(2 * overlap)] += value;
+    }
+  }
+
+  // Cleanup
+  fftw_destroy_plan(fft_plan);
+  fftw_free(fft);
+
+  return audio;
+}
+
+std::vector<std::vector<spectral::point>> analysis(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+
+  // Convert the window size to samples
+  size_t N = std::round(window_size * sample_rate);
+  // Make sure it is even for symmetry
+  while (N % (2 * overlap) != 0) N += 1;
+  size_t N_padded = N * (1 + padding);
+  // Initialize the windows
+  std::vector<double> window(N_padded, 0), window_t(N_padded, 0), window_d(N_padded, 0);
+
+  // Determine samples used for padding
+  size_t padding_samples = (N_padded - N)/2;
+
+  // Compute the number of windows
+  // Accounting for an overlap factor of 2 * overlap
+  size_t num_hops = std::floor(audio.size()/(N/(2 * overlap)));
+  size_t num_windows = num_hops - (2 * overlap - 1);
+
+  // Initialize FFT
+  size_t fft_size = N_padded/2 + 1;
+  fftw_complex * fft, * fft_t, * fft_d;
+  fft   = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
+  fft_t = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
+  fft_d = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
+  fftw_plan fft_plan    = fftw_plan_dft_r2c_1d(
+      window.size(),
+      window.data(),
+      fft,
+      FFTW_MEASURE);
+  fftw_plan fft_plan_t  = fftw_plan_dft_r2c_1d(
+      window_t.size(),
+      window_t.data(),
+      fft_t,
+      FFTW_MEASURE);
+  fftw_plan fft_plan_d  = fftw_plan_dft_r2c_1d(
+      window_d.size(),
+      window_d.data(),
+      fft_d,
+      FFTW_MEASURE);
+
+  // Initialize the spectral points
+  std::vector<std::vector<spectral::point>> points(num_windows);
+
+  // Iterate over the windows
+  for (size_t w = 0; w < num_windows; w++) {
+
+    // Reserve space for each spectral point in each channel
+    points[w].reserve(fft_size);
+
+    // Apply the various windows
+    for (size_t i = 0; i < N; i++) {
+      // The sample index of with window
+      // if the center of the window has n = 0
+      double n = i - (N - 1)/2.;
+
+      // The audio sample to window accounting for overlap of 2 * overlap
+      double a = audio[i + w * N/(2 * overlap)];
+
+      // Apply the various windows
+      window  [i + padding_samples] = a * spectral::hann  (n, N);
+      window_t[i + padding_samples] = a * spectral::hann_t(n, N, sample_rate);
+      window_d[i + padding_samples] = a * spectral::hann_d(n, N, sample_rate);
+    }
+
+    // Execute the plans
+    fftw_execute(fft_plan);
+    fftw_execute(fft_plan_t);
+    fftw_execute(fft_plan_d);
+
+    // Compute the center time
+    double t = ((N - 1)/2. + w * N/(2 * overlap))/sample_rate;
+
+    for (size_t i = 0; i < fft_size; i++) {
+      // Convert to C++ complex
+      std::complex<double> X   (fft   [i][0], fft   [i][1]);
+      std::complex<double> X_t (fft_t [i][0], fft_t [i][1]);
+      std::complex<double> X_d (fft_d [i][0], fft_d [i][1]);
+
+      // Begin to construct a spectral point
+      spectral::point p;
+      p.value = X;
+      p.time = t;
+      p.freq = (2 * M_PI * i * sample_rate)/(double) N_padded;
+
+      // Compute how the frequency and time changed
+      std::complex<double> conj_over_norm = std::conj(X)/std::norm(X);
+      double dphase_domega =  std::real(X_t * conj_over_norm);
+      double dphase_dt     = -std::imag(X_d * conj_over_norm);
+
+      // Compute the reassigned time and frequency
+      p.time_reassigned = p.time + dphase_domega;
+      p.freq_reassigned = p.freq + dphase_dt;
+
+      // Add the point
+      points[w].push_back(p);
+    }
+  }
+
+  // Cleanup
+  fftw_destroy_plan(fft_plan);
+  fftw_destroy_plan(fft_plan_t);
+  fftw_destroy_plan(fft_plan_d);
+  fftw_free(fft);
+  fftw_free(fft_t);
+  fftw_free(fft_d);
+
+  return points;
+}
+
+void place_mass(
+    const spectral_mass & mass,
+    int center_bin,
+    double scale,
+    double interpolated_freq,
+    double center_phase,
+    const std::vector<spectral::point> & input,
+    std::vector<spectral::point> & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes) {
+
+  // Compute how the phase changes in each bin
+  double phase_shift = center_phase - std::arg(input[mass.center_bin].value);
+
+  for (size_t i = mass.left_bin; i < mass.right_bin; i++) {
+    // Compute the location in the new array
+    int new_i = i + center_bin - mass.center_bin;
+    if (new_i < 0) continue;
+    if (new_i >= (int) output.size()) continue;
+
+    // Rotate the output by the phase offset
+    // plus the frequency
+    double phase = phase_shift + std::arg(input[i].value);
+    double mag = scale * std::abs(input[i].value);
+    output[new_i].value += std::polar(mag, phase);
+
+    if (mag > amplitudes[new_i]) {
+      amplitudes[new_i] = mag;
+      phases[new_i] = next_phase;
+      output[new_i].freq_reassigned = interpolated_freq;
+    }
+  }
+}
+
+std::vector<std::tuple<size_t, size_t, double>> transport_matrix(
+    const std::vector<spectral_mass> & left,
+    const std::vector<spectral_mass> & right) {
+
+  // Initialize the algorithm
+  std::vector<std::tuple<size_t, size_t, double>> T;
+  size_t left_index = 0, right_index = 0;
+  double left_mass  = left[0].mass;
+  double right_mass = right[0].mass;
+
+  while (true) {
+    if (left_mass < right_mass) {
+      T.emplace_back(
+          left_index,
+          right_index,
+          left_mass);
+
+      right_mass -= left_mass;
+
+      left_index += 1;
+      if (left_index >= left.size()) break;
+      left_mass = left[left_index].mass;
+    } else {
+      T.emplace_back(
+          left_index,
+          right_index,
+          right_mass);
+
+      left_mass -= right_mass;
+
+      right_index += 1;
+      if (right_index >= right.size()) break;
+      right_mass = right[right_index].mass;
+    }
+  }
+
+  return T;
+}
+
+std::vector<spectral_mass> group_spectrum(
+   const std::vector<spectral::point> & spectrum
+   ) {
+
+  // Keep track of the total mass
+  double mass_sum = 0;
+  for (size_t i = 0; i < spectrum.size(); i++) {
+    mass_sum += std::abs(spectrum[i].value);
+  }
+
+  // Initialize the first mass
+  std::vector<spectral_mass> masses;
+  spectral_mass initial_mass;
+  initial_mass.left_bin = 0;
+  initial_mass.center_bin = 0;
+  masses.push_back(initial_mass);
+
+  bool sign = false;
+  bool first = true;
+  for (size_t i = 0; i < spectrum.size(); i++) {
+    bool current_sign = (spectrum[i].freq_reassigned > spectrum[i].freq);
+
+    if (first) {
+      first = false;
+      sign = current_sign;
+      continue;
+    }
+
+    if (current_sign == sign) continue;
+
+    if (sign) {
+      // We are falling
+      // This is the center bin
+      // Choose the one closest to the right
+
+      // These should both be positive
+      double left_dist = spectrum[i - 1].freq_reassigned - spectrum[i - 1].freq;
+      double right_dist = spectrum[i].freq - spectrum[i].freq_reassigned;
+
+      // Go to the closer side
+      if (left_dist < right_dist) {
+        masses[masses.size() - 1].center_bin = i - 1;
+      } else {
+        masses[masses.size() - 1].center_bin = i;
+      }
+    } else {
+      // We are rising
+      // This is the end
+
+      // Compute the actual mass
+      masses[masses.size() - 1].mass = 0;
+      for (size_t j = masses[masses.size() - 1].left_bin; j < i; j++) {
+        masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
+      }
+
+      if (masses[masses.size() - 1].mass > 0) {
+        // Normalize
+        masses[masses.size() - 1].mass /= mass_sum;
+
+        // Set the end of the mass
+        masses[masses.size() - 1].right_bin = i;
+
+        // Construct a new mass
+        spectral_mass mass;
+        mass.left_bin = i;
+        mass.center_bin = i;
+        masses.push_back(mass);
+      }
+    }
+    sign = current_sign;
+  }
+
+  // Finish the last mass
+  masses[masses.size() - 1].right_bin = spectrum.size();
+  masses[masses.size() - 1].mass = 0;
+  for (size_t j = masses[masses.size() - 1].left_bin; j < spectrum.size(); j++) {
+    masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
+  }
+  masses[masses.size() - 1].mass /= mass_sum;
+
+  return masses;
+}
+
+std::vector<spectral::point> interpolate(
+    const std::vector<spectral::point> & left,
+    const std::vector<spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation) {
+
+  // Group the left and right spectra
+  std::vector<spectral_mass> left_masses = group_spectrum(left);
+  std::vector<spectral_mass> right_masses = group_spectrum(right);
+
+  // Get the transport matrix
+  std::vector<std::tuple<size_t, size_t, double>> T =
+    reference::transport_matrix(left_masses, right_masses);
+
+  // Initialize the output spectral masses
+  std::vector<spectral::point> interpolated(left.size());
+  for (unsigned int i = 0; i < left.size(); i++) {
+    interpolated[i].freq = left[i].freq;
+  }
+
+  // Initialize new phases
+  std::vector<double> new_amplitudes(phases.size(), 0);
+  std::vector<double> new_phases(phases.size(), 0);
+
+  // Perform the interpolation
+  for (auto t : T) {
+    spectral_mass left_mass  =  left_masses[std::get<0>(t)];
+    spectral_mass right_mass = right_masses[std::get<1>(t)];
+
+    // Calculate the new bin and frequency
+    int interpolated_bin = std::round(
+      (1 - interpolation) * left_mass.center_bin +
+      interpolation * right_mass.center_bin
+      );
+
+    // Compute the actual interpolation factor given the new bin
+    double interpolation_rounded = interpolation;
+    if (left_mass.center_bin != right_mass.center_bin) {
+      interpolation_rounded =
+        ((double)interpolated_bin - (double)left_mass.center_bin)/
+        ((double)right_mass.center_bin - (double)left_mass.center_bin);
+    }
+    // Interpolate the frequency appropriately
+    double interpolated_freq =
+      (1 - interpolation_rounded) * left[left_mass.center_bin].freq_reassigned +
+      interpolation_rounded * right[right_mass.center_bin].freq_reassigned;
+
+    double center_phase =
+      phases[interpolated_bin] + (interpolated_freq * window_size/2.)/2. - (M_PI * interpolated_bin);
+    double new_phase =
+      center_phase + (interpolated_freq * window_size/2.)/2. + (M_PI * interpolated_bin);
+
+    // Place the left and right masses
+    reference::place_mass(
+        left_mass,
+        interpolated_bin,
+        (1 - interpolation) * std::get<2>(t)/left_mass.mass,
+        interpolated_freq,
+        center_phase,
+        left,
+        interpolated,
+        new_phase,
+        new_phases,
+        new_amplitudes
+        );
+    reference::place_mass(
+        right_mass,
+        interpolated_bin,
+        interpolation * std::get<2>(t)/right_mass.mass,
+        interpolated_freq,
+        center_phase,
+        right,
+        interpolated,
+        new_phase,
+        new_phases,
+        new_amplitudes
+        );
+  }
+
+  // Fill the phases with the new phases
+  for (size_t i = 0; i < phases.size(); i++) {
+    phases[i] = new_phases[i];
+  }
+
+  return interpolated;
+}
+
+}
+
+///////////////
+// Metrics
+///////////////
+
+struct metrics {
+  metrics() :
+    signal(0), error(0), peak(0), max_error(0),
+    partitioned_mass(0), equal_mass(0) {}
+
+  void add(std::complex<double> expected, std::complex<double> actual) {
+    double e = std::abs(actual - expected);
+    signal += std::norm(expected);
+    error += e * e;
+    peak = std::max(peak, std::abs(expected));
+    max_error = std::max(max_error, e);
+  }
+
+  void add(
+      const std::vector<spectral::point> & expected,
+      const std::vector<spectral::point> & actual,
+      bool phases = true) {
+    for (size_t i = 0; i < expected.size(); i++) {
+      if (phases) {
+        add(expected[i].value, actual[i].value);
+      } else {
+        add(std::abs(expected[i].value), std::abs(actual[i].value));
+      }
+    }
+    add_partition(reference::group_spectrum(expected), reference::group_spectrum(actual));
+  }
+
+  // Masses whose bins differ in the two partitions count as
+  // unequal. Weighting by mass keeps sign flips in the noise
+  // floor from hiding the masses that matter.
+  void add_partition(
+      const std::vector<spectral_mass> & expected,
+      const std::vector<spectral_mass> & actual) {
+    // Both are ordered by bin
+    size_t j = 0;
+    for (const spectral_mass & mass : expected) {
+      while (j < actual.size() and actual[j].left_bin < mass.left_bin) j++;
+      bool equal =
+        j < actual.size() and
+        actual[j].left_bin == mass.left_bin and
+        actual[j].right_bin == mass.right_bin and
+        actual[j].center_bin == mass.center_bin;
+
+      partitioned_mass += mass.mass;
+      if (equal) equal_mass += mass.mass;
+    }
+  }
+
+  // In dB, infinite when identical
+  double snr() const { return 10 * std::log10(signal/error); }
+  // Relative to the largest expected value
+  double relative_max_error() const { return max_error/peak; }
+  // The fraction of the mass in equal partitions
+  double equal_partitions() const {
+    return partitioned_mass > 0 ? equal_mass/partitioned_mass : 1;
+  }
+
+  double signal, error, peak, max_error;
+  double partitioned_mass, equal_mass;
+};
+
+///////////////
+// Corpus
+///////////////
+
+struct input {
+  std::string name;
+  std::vector<double> audio;
+};
+
+std::vector<input> corpus() {
+  size_t n = sample_rate * total_time;
+  std::vector<input> inputs;
+  std::srand(1);
+
+  input tone{"tone", std::vector<double>(n)};
+  input chirp{"chirp", std::vector<double>(n)};
+  input noise{"noise", std::vector<double>(n)};
+  input clicks{"clicks", std::vector<double>(n)};
+  input noisy_tone{"noisy tone", std::vector<double>(n)};
+  for (size_t i = 0; i < n; i++) {
+    double t = i/sample_rate;
+    for (size_t h = 1; h <= 6; h++) {
+      tone.audio[i] += std::sin(2 * M_PI * h * 196 * t)/h;
+    }
+    chirp.audio[i] = std::sin(2 * M_PI * (100 + 2000 * t) * t);
+    noise.audio[i] = std::rand()/(double) RAND_MAX - 0.5;
+    // Every 20ms so that no window is silent
+    clicks.audio[i] = (i % 441 == 0) ? 1 : 0;
+    noisy_tone.audio[i] = std::sin(2 * M_PI * 440 * t) + 0.1 * noise.audio[i];
+  }
+  inputs.push_back(tone);
+  inputs.push_back(chirp);
+  inputs.push_back(noise);
+  inputs.push_back(clicks);
+  inputs.push_back(noisy_tone);
+
+  return inputs;
+}
+
+///////////////
+// Paths
+///////////////
+
+struct path {
+  std::string name;
+  // Thresholds
+  double min_snr;
+  double min_equal_partitions;
+  // Accumulates the metrics and times of the reference
+  // and of the path on one signal and the next
+  std::function<void(
+      const input &,
+      const input &,
+      metrics &,
+      double & reference_time,
+      double & time)> run;
+};
+
+// Analysed by the reference, shared by the paths
+// that start from spectra
+struct analysed {
+  frames points;
+  double time;
+};
+
+int main(int argc, char ** argv) {
+  std::vector<input> signals = corpus();
+
+  std::vector<analysed> reference_points(signals.size());
+  for (size_t s = 0; s < signals.size(); s++) {
+    reference_points[s].time = seconds([&] {
+        reference_points[s].points = reference::analysis(
+            signals[s].audio, sample_rate, window_size, padding, 1);
+      });
+  }
+  auto reference_of = [&](const input & s) -> const analysed & {
+    return reference_points[&s - signals.data()];
+  };
+
+  auto analysis_path = [&](spectral::transform method, unsigned int num_threads) {
+    return [&, method, num_threads](
+        const input & s, const input &, metrics & m, double & reference_time, double & time) {
+      context ctx(num_threads);
+      frames points;
+      time += seconds([&] {
+          points = spectral::analysis(ctx, s.audio, sample_rate, window_size, padding, 1, method);
+        });
+      const analysed & expected = reference_of(s);
+      reference_time += expected.time;
+      for (size_t w = 0; w < expected.points.size(); w++) {
+        m.add(expected.points[w], points[w]);
+      }
+    };
+  };
+
+  auto synthesis_path = [&](spectral::transform method, unsigned int num_threads) {
+    return [&, method, num_threads](
+        const input & s, const input &, metrics & m, double & reference_time, double & time) {
+      const frames & points = reference_of(s).points;
+      context ctx(num_threads);
+      std::vector<double> expected, audio;
+      reference_time += seconds([&] {
+          expected = reference::synthesis(points, padding, 1);
+        });
+      time += seconds([&] {
+          audio = spectral::synthesis(ctx, points, padding, 1, method);
+        });
+      for (size_t i = 0; i < expected.size(); i++) {
+        m.add(expected[i], audio[i]);
+      }
+    };
+  };
+
+  // Interpolates each frame of one signal towards the next
+  auto interpolate_path = [&](
+      std::function<frames(const frames &, const frames &)> interpolate_all,
+      bool phases = true) {
+    return [&, interpolate_all, phases](
+        const input & l, const input & r, metrics & m, double & reference_time, double & time) {
+      const frames & left = reference_of(l).points;
+      const frames & right = reference_of(r).points;
+      size_t num_frames = std::min(left.size(), right.size());
+
+      frames expected(num_frames), interpolated;
+      reference_time += seconds([&] {
+          std::vector<double> phases(left[0].size(), 0);
+          for (size_t w = 0; w < num_frames; w++) {
+            expected[w] = reference::interpolate(left[w], right[w], phases, window_size, interpolation);
+          }
+        });
+      time += seconds([&] {
+          interpolated = interpolate_all(left, right);
+        });
+      for (size_t w = 0; w < num_frames; w++) {
+        m.add(expected[w], interpolated[w], phases);
+      }
+    };
+  };
+
+  monotone_solver solver;
+
+  // Rounding differences flip which side of a bin some
+  // reassigned frequencies land on, which moves mass
+  // boundaries in flat spectra such as noise
+  std::vector<path> paths = {
+    {"analysis/padded", 200, 0.99, analysis_path(spectral::transform::padded, 1)},
+    {"analysis/pruned", 200, 0.99, analysis_path(spectral::transform::pruned, 1)},
+    {"analysis/threads", 200, 0.99, analysis_path(spectral::transform::automatic, 4)},
+    {"analysis/stream", 200, 0.99,
+      [&](const input & s, const input &, metrics & m, double & reference_time, double & time) {
+        spectral::stream_analyzer analyzer(sample_rate, window_size, padding, 1, spectral::transform::automatic);
+        spectral::frame_ring<spectral::point> ring(4, analyzer.fft_size());
+        frames points;
+        time += seconds([&] {
+            for (size_t i = 0; i < s.audio.size();) {
+              i += analyzer.write(&s.audio[i], std::min<size_t>(512, s.audio.size() - i), ring);
+              while (ring.size() > 0) {
+                points.push_back(*ring.front());
+                ring.pop();
+              }
+            }
+          });
+        const analysed & expected = reference_of(s);
+        reference_time += expected.time;
+        for (size_t w = 0; w < expected.points.size(); w++) {
+          m.add(expected.points[w], points[w]);
+        }
+      }},
+    {"synthesis/padded", 200, 1, synthesis_path(spectral::transform::padded, 1)},
+    {"synthesis/pruned", 200, 1, synthesis_path(spectral::transform::pruned, 1)},
+    {"synthesis/threads", 200, 1, synthesis_path(spectral::transform::automatic, 4)},
+    {"group_spectrum", 200, 1,
+      [&](const input & s, const input &, metrics & m, double & reference_time, double & time) {
+        const frames & points = reference_of(s).points;
+        std::vector<std::vector<spectral_mass>> expected(points.size()), masses(points.size());
+        reference_time += seconds([&] {
+            for (size_t w = 0; w < points.size(); w++) {
+              expected[w] = reference::group_spectrum(points[w]);
+            }
+          });
+        time += seconds([&] {
+            for (size_t w = 0; w < points.size(); w++) {
+              masses[w] = group_spectrum(points[w]);
+            }
+          });
+        for (size_t w = 0; w < points.size(); w++) {
+          m.add_partition(expected[w], masses[w]);
+          for (size_t i = 0; i < std::min(expected[w].size(), masses[w].size()); i++) {
+            m.add(expected[w][i].mass, masses[w][i].mass);
+          }
+        }
+      }},
+    {"transport_matrix", 200, 1,
+      [&](const input & l, const input & r, metrics & m, double & reference_time, double & time) {
+        const frames & left = reference_of(l).points;
+        const frames & right = reference_of(r).points;
+        size_t num_frames = std::min(left.size(), right.size());
+
+        std::vector<std::vector<spectral_mass>> left_masses(num_frames), right_masses(num_frames);
+        for (size_t w = 0; w < num_frames; w++) {
+          left_masses[w] = reference::group_spectrum(left[w]);
+          right_masses[w] = reference::group_spectrum(right[w]);
+        }
+
+        std::vector<std::vector<std::tuple<size_t, size_t, double>>> expected(num_frames), plans(num_frames);
+        reference_time += seconds([&] {
+            for (size_t w = 0; w < num_frames; w++) {
+              expected[w] = reference::transport_matrix(left_masses[w], right_masses[w]);
+            }
+          });
+        time += seconds([&] {
+            for (size_t w = 0; w < num_frames; w++) {
+              plans[w] = solver.solve(left_masses[w], right_masses[w], left[w], right[w]);
+            }
+          });
+
+        // A plan partitions the pairs of masses
+        for (size_t w = 0; w < num_frames; w++) {
+          for (size_t i = 0; i < expected[w].size(); i++) {
+            bool equal =
+              i < plans[w].size() and
+              std::get<0>(expected[w][i]) == std::get<0>(plans[w][i]) and
+              std::get<1>(expected[w][i]) == std::get<1>(plans[w][i]);
+            m.add(std::get<2>(expected[w][i]), equal ? std::get<2>(plans[w][i]) : 0);
+            m.partitioned_mass += std::get<2>(expected[w][i]);
+            if (equal) m.equal_mass += std::get<2>(expected[w][i]);
+          }
+        }
+      }},
+    {"interpolate", 200, 1, interpolate_path([&](const frames & left, const frames & right) {
+        frames interpolated(std::min(left.size(), right.size()));
+        std::vector<double> phases(left[0].size(), 0);
+        for (size_t w = 0; w < interpolated.size(); w++) {
+          interpolated[w] = interpolate(left[w], right[w], phases, window_size, interpolation);
+        }
+        return interpolated;
+      })},
+    {"interpolate/curve", 200, 1, interpolate_path([&](const frames & left, const frames & right) {
+        return interpolate(left, right, window_size, constant_curve(interpolation));
+      })},
+    {"interpolate/threads", 200, 1, interpolate_path([&](const frames & left, const frames & right) {
+        context ctx(4);
+        return interpolate(ctx, left, right, window_size, constant_curve(interpolation));
+      })},
+    // Tonal masses are rendered from their frequency rather
+    // than copied, so only their main lobes agree closely
+    {"interpolate/tonal", 30, 0.9, interpolate_path([&](const frames & left, const frames & right) {
+        tonal_renderer tonal(left[0].size(), padding);
+        frames interpolated(std::min(left.size(), right.size()));
+        std::vector<double> phases(left[0].size(), 0);
+        for (size_t w = 0; w < interpolated.size(); w++) {
+          interpolated[w] = interpolate(
+              left[w], right[w], phases, window_size, interpolation, solver, tonal);
+        }
+        return interpolated;
+      })},
+    {"interpolate/tonal/threads", 30, 0.9, interpolate_path([&](const frames & left, const frames & right) {
+        context ctx(4);
+        tonal_renderer tonal(left[0].size(), padding);
+        return interpolate(ctx, left, right, window_size, constant_curve(interpolation), solver, tonal);
+      })},
+    // Rounding the masses of encoded frames changes which mass
+    // sets the phase of a shared bin, and phases carry over
+    // from frame to frame, so only magnitudes are compared
+    {"interpolate/codec", 30, 0.9, interpolate_path([&](const frames & left, const frames & right) {
+        return interpolate(
+            spectral::encode(left), spectral::encode(right), window_size, constant_curve(interpolation));
+      }, false)},
+    {"interpolate/codec/half", 30, 0.9, interpolate_path([&](const frames & left, const frames & right) {
+        spectral::codec_options options;
+        options.magnitudes = spectral::magnitude_format::half;
+        return interpolate(
+            spectral::encode(left, options), spectral::encode(right, options),
+            window_size, constant_curve(interpolation));
+      }, false)},
+  };
+
+  // Override the thresholds: path=min_snr[,min_equal_partitions]
+  for (int a = 1; a < argc; a++) {
+    std::string arg = argv[a];
+    size_t equals = arg.find('=');
+    bool found = false;
+    for (path & p : paths) {
+      if (equals == std::string::npos or arg.substr(0, equals) != p.name) continue;
+      std::string thresholds = arg.substr(equals + 1);
+      p.min_snr = std::atof(thresholds.c_str());
+      size_t comma = thresholds.find(',');
+      if (comma != std::string::npos) {
+        p.min_equal_partitions = std::atof(thresholds.c_str() + comma + 1);
+      }
+      found = true;
+    }
+    if (not found) {
+      std::cerr << "Unknown threshold " << arg << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout <<
+    "Comparing against the reference on " << signals.size() << " signals of " <<
+    total_time << "s at " << sample_rate << "Hz, padding " << padding << std::endl;
+  std::cout << std::left <<
+    std::setw(28) << "path" <<
+    std::setw(12) << "SNR (dB)" <<
+    std::setw(14) << "max error" <<
+    std::setw(12) << "partitions" <<
+    std::setw(14) << "reference (s)" <<
+    std::setw(12) << "path (s)" <<
+    std::setw(10) << "speedup" << std::endl;
+
+  int failures = 0;
+  for (const path & p : paths) {
+    metrics m;
+    double reference_time = 0, time = 0;
+    for (size_t s = 0; s < signals.size(); s++) {
+      p.run(signals[s], signals[(s + 1) % signals.size()], m, reference_time, time);
+    }
+
+    bool pass = m.snr() >= p.min_snr and m.equal_partitions() >= p.min_equal_partitions;
+    if (not pass) failures++;
+
+    std::cout << std::left <<
+      std::setw(28) << p.name <<
+      std::setw(12) << m.snr() <<
+      std::setw(14) << m.relative_max_error() <<
+      std::setw(12) << m.equal_partitions() <<
+      std::setw(14) << reference_time <<
+      std::setw(12) << time <<
+      std::setw(10) << reference_time/time <<
+      (pass ? "pass" : "FAIL") << std::endl;
+  }
+
+  return failures;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/codec.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 2; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+
+typedef std::vector<std::vector<audio_transport::spectral::point>> frames;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A harmonic tone with some noise
+std::vector<double> tone(double fundamental, double noise) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (int h = 1; h <= 8; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+    audio[i] += noise * (std::rand()/(double) RAND_MAX - 0.5);
+  }
+  return audio;
+}
+
+size_t bytes_of(const frames & points) {
+  size_t bytes = 0;
+  for (const std::vector<audio_transport::spectral::point> & frame : points) {
+    bytes += sizeof(frame) + frame.capacity() * sizeof(audio_transport::spectral::point);
+  }
+  return bytes;
+}
+
+size_t bytes_of(const std::vector<audio_transport::spectral::encoded_frame> & frames) {
+  size_t bytes = 0;
+  for (const audio_transport::spectral::encoded_frame & frame : frames) {
+    bytes += frame.bytes();
+  }
+  return bytes;
+}
+
+// The error in the magnitudes of the interpolated frames (dB).
+// Phases are left out: rounding the masses changes which mass
+// sets the phase of a shared bin, which carries over to later
+// frames without being heard.
+double snr(const frames & expected, const frames & actual) {
+  double signal = 0, error = 0;
+  for (size_t w = 0; w < expected.size(); w++) {
+    for (size_t i = 0; i < expected[w].size(); i++) {
+      double e = std::abs(expected[w][i].value);
+      double a = std::abs(actual[w][i].value);
+      signal += e * e;
+      error += (e - a) * (e - a);
+    }
+  }
+  return 10 * std::log10(signal/error);
+}
+
+int main() {
+  using namespace audio_transport;
+
+  frames left = spectral::analysis(tone(220, 0.1), sample_rate, window_size, padding);
+  frames right = spectral::analysis(tone(330, 0.1), sample_rate, window_size, padding);
+  constant_curve halfway(0.5);
+
+  frames expected;
+  double point_time = seconds([&] {
+      expected = interpolate(left, right, window_size, halfway);
+    });
+  size_t point_bytes = bytes_of(left) + bytes_of(right);
+
+  std::cout <<
+    "Interpolating " << left.size() << " frames of harmonic tones, " <<
+    point_bytes/1e6 << "MB of points, in " << point_time << "s" << std::endl;
+
+  struct setting {
+    std::string name;
+    spectral::magnitude_format magnitudes;
+    double floor;
+  };
+  std::vector<setting> settings = {
+    {"log", spectral::magnitude_format::log, 0},
+    {"half", spectral::magnitude_format::half, 0},
+    {"log, floor -80dB", spectral::magnitude_format::log, 1e-4},
+    {"log, floor -60dB", spectral::magnitude_format::log, 1e-3},
+  };
+
+  for (const setting & s : settings) {
+    spectral::codec_options options;
+    options.magnitudes = s.magnitudes;
+    options.floor = s.floor;
+
+    std::vector<spectral::encoded_frame> encoded_left, encoded_right;
+    double encode_time = seconds([&] {
+        encoded_left = spectral::encode(left, options);
+        encoded_right = spectral::encode(right, options);
+      });
+    size_t encoded_bytes = bytes_of(encoded_left) + bytes_of(encoded_right);
+
+    frames interpolated;
+    double interpolate_time = seconds([&] {
+        interpolated = interpolate(encoded_left, encoded_right, window_size, halfway);
+      });
+
+    // Decoding everything first was the alternative
+    double decoded_time = seconds([&] {
+        interpolate(
+            spectral::decode(encoded_left),
+            spectral::decode(encoded_right),
+            window_size,
+            halfway);
+      });
+
+    std::cout <<
+      s.name << ": " <<
+      encoded_bytes/1e6 << "MB (" << point_bytes/(double) encoded_bytes << "x smaller), " <<
+      "encode " << encode_time << "s, " <<
+      "interpolate " << interpolate_time << "s " <<
+      "(" << interpolate_time/point_time << "x, " <<
+      decoded_time/point_time << "x decoding first), " <<
+      "magnitude SNR " << snr(expected, interpolated) << "dB" << std::endl;
+  }
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/context.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 2; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+unsigned int overlap = 2; // hops per half window
+
+typedef std::vector<std::vector<audio_transport::spectral::point>> frames;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A harmonic tone with some noise
+std::vector<double> tone(double fundamental, double noise) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (int h = 1; h <= 8; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+    audio[i] += noise * (std::rand()/(double) RAND_MAX - 0.5);
+  }
+  return audio;
+}
+
+struct render {
+  frames left, right, interpolated;
+  std::vector<double> audio;
+  double analysis_time, interpolation_time, synthesis_time;
+};
+
+render morph(
+    audio_transport::context & ctx,
+    const std::vector<double> & left,
+    const std::vector<double> & right) {
+  using namespace audio_transport;
+
+  render r;
+  r.analysis_time = seconds([&] {
+      r.left = spectral::analysis(ctx, left, sample_rate, window_size, padding, overlap);
+      r.right = spectral::analysis(ctx, right, sample_rate, window_size, padding, overlap);
+    });
+  r.interpolation_time = seconds([&] {
+      r.interpolated = interpolate(ctx, r.left, r.right, window_size, constant_curve(0.5), overlap);
+    });
+  r.synthesis_time = seconds([&] {
+      r.audio = spectral::synthesis(ctx, r.interpolated, padding, overlap);
+    });
+  return r;
+}
+
+bool identical(const frames & a, const frames & b) {
+  if (a.size() != b.size()) return false;
+  for (size_t w = 0; w < a.size(); w++) {
+    if (a[w].size() != b[w].size()) return false;
+    for (size_t i = 0; i < a[w].size(); i++) {
+      if (std::memcmp(&a[w][i], &b[w][i], sizeof(a[w][i])) != 0) return false;
+    }
+  }
+  return true;
+}
+
+bool identical(const std::vector<double> & a, const std::vector<double> & b) {
+  return a.size() == b.size() and
+    std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0;
+}
+
+int main() {
+  using namespace audio_transport;
+
+  std::vector<double> left = tone(220, 0.1);
+  std::vector<double> right = tone(330, 0.1);
+
+  // One thread is the output every other run must match
+  context single(1);
+  render expected = morph(single, left, right);
+
+  std::cout <<
+    "Morphing " << total_time << "s of harmonic tones at overlap " << overlap <<
+    ", times in seconds, \"same\" when bit-identical to one thread" << std::endl;
+
+  unsigned int failures = 0;
+  for (unsigned int num_threads : {1, 2, 4, 8}) {
+    for (bool deterministic : {true, false}) {
+      context ctx(num_threads);
+      ctx.set_deterministic(deterministic);
+      render r = morph(ctx, left, right);
+
+      bool same_analysis =
+        identical(expected.left, r.left) and identical(expected.right, r.right);
+      bool same_interpolation = identical(expected.interpolated, r.interpolated);
+      bool same_audio = identical(expected.audio, r.audio);
+      if (deterministic and not (same_analysis and same_interpolation and same_audio)) {
+        failures++;
+      }
+
+      std::cout <<
+        num_threads << " threads, " <<
+        (deterministic ? "deterministic: " : "free running:  ") <<
+        "analysis " << r.analysis_time << (same_analysis ? " same" : " differs") << ", " <<
+        "interpolate " << r.interpolation_time << (same_interpolation ? " same" : " differs") << ", " <<
+        "synthesis " << r.synthesis_time << (same_audio ? " same" : " differs") << std::endl;
+    }
+  }
+
+  return failures;
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <ciso646>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 4; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+double click_period = 0.25; // seconds
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+bool is_click(size_t i) {
+  return i % (size_t) (click_period * sample_rate) == 0;
+}
+
+// A low tone under a train of clicks
+std::vector<double> clicks_over(double fundamental) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    audio[i] = 0.3 * std::sin(2 * M_PI * fundamental * i/sample_rate);
+    if (is_click(i)) audio[i] += 1;
+  }
+  return audio;
+}
+
+// The fraction of the high frequency energy of the
+// audio within a short window of the clicks
+double concentration(const std::vector<double> & audio, double short_window_size) {
+  size_t radius = short_window_size * sample_rate/2;
+  size_t period = click_period * sample_rate;
+
+  double near = 0, total = 0;
+  for (size_t i = 2; i < audio.size(); i++) {
+    // A second difference removes the tone
+    double high = audio[i] - 2 * audio[i - 1] + audio[i - 2];
+    double distance = std::min(i % period, period - i % period);
+    total += high * high;
+    if (distance <= radius) near += high * high;
+  }
+  return near/total;
+}
+
+// Whether a single frame holding a click at sample i keeps
+// every bin finite and no louder than the long window makes
+// it, and if missed is set, is left to the long window
+bool sharpens_safely(
+    size_t i,
+    size_t N,
+    bool missed,
+    const audio_transport::spectral::multiresolution_options & options) {
+  using namespace audio_transport;
+
+  std::vector<double> audio(N, 0);
+  audio[i] = 1;
+  std::vector<std::vector<spectral::point>> single =
+    spectral::analysis(audio, sample_rate, window_size, padding);
+  std::vector<std::vector<spectral::point>> multi =
+    spectral::multiresolution_analysis(audio, sample_rate, window_size, padding, 1, options);
+
+  double loudest = 0;
+  for (const spectral::point & p : single[0]) {
+    loudest = std::max(loudest, std::abs(p.value));
+  }
+  for (size_t b = 0; b < multi[0].size(); b++) {
+    double magnitude = std::abs(multi[0][b].value);
+    if (not std::isfinite(magnitude) or magnitude > 2 * loudest) return false;
+    if (missed and multi[0][b].value != single[0][b].value) return false;
+  }
+  return true;
+}
+
+int main() {
+  using namespace audio_transport;
+
+  std::vector<double> left = clicks_over(220);
+  std::vector<double> right = clicks_over(330);
+  spectral::multiresolution_options options;
+
+  std::cout <<
+    "Transporting halfway between clicks over 220Hz and 330Hz, " <<
+    "scored by the fraction of the click energy within " <<
+    1000 * options.short_window_size/2 << "ms of each click" << std::endl;
+
+  std::vector<std::vector<spectral::point>> points_left, points_right;
+
+  double single_time = seconds([&] {
+      points_left = spectral::analysis(left, sample_rate, window_size, padding);
+      points_right = spectral::analysis(right, sample_rate, window_size, padding);
+    });
+  std::vector<double> single = spectral::synthesis(
+      interpolate(points_left, points_right, window_size, constant_curve(0.5)),
+      padding);
+
+  // Running everything twice at either size was the alternative
+  double two_pass_time = seconds([&] {
+      spectral::analysis(left, sample_rate, window_size, padding);
+      spectral::analysis(right, sample_rate, window_size, padding);
+      spectral::analysis(left, sample_rate, options.short_window_size, padding);
+      spectral::analysis(right, sample_rate, options.short_window_size, padding);
+    });
+
+  std::vector<std::vector<spectral::point>> multi_left, multi_right;
+  double multi_time = seconds([&] {
+      multi_left = spectral::multiresolution_analysis(
+          left, sample_rate, window_size, padding, 1, options);
+      multi_right = spectral::multiresolution_analysis(
+          right, sample_rate, window_size, padding, 1, options);
+    });
+  std::vector<double> multi = spectral::synthesis(
+      interpolate(multi_left, multi_right, window_size, constant_curve(0.5)),
+      padding);
+
+  // Count the frames with a short window
+  size_t num_sharpened = 0;
+  for (size_t w = 0; w < points_left.size(); w++) {
+    for (size_t i = 0; i < points_left[w].size(); i++) {
+      if (points_left[w][i].value != multi_left[w][i].value) {
+        num_sharpened++;
+        break;
+      }
+    }
+  }
+
+  std::cout <<
+    "single resolution: analysis " << single_time << "s, " <<
+    "concentration " << concentration(single, options.short_window_size) << std::endl;
+  std::cout <<
+    "multiresolution: analysis " << multi_time << "s " <<
+    "(" << multi_time/single_time << "x), " <<
+    num_sharpened << " of " << points_left.size() << " frames sharpened, " <<
+    "concentration " << concentration(multi, options.short_window_size) << std::endl;
+  std::cout <<
+    "two passes: analysis " << two_pass_time << "s " <<
+    "(" << two_pass_time/single_time << "x)" << std::endl;
+
+  // The short window is clamped to the frame, so clicks in
+  // its first and last few milliseconds are the hardest. In
+  // the outer quarter of the short window they are missed
+  size_t N = std::round(window_size * sample_rate);
+  // Analysis makes the window even
+  if (N % 2 != 0) N += 1;
+  size_t edge = 0.005 * sample_rate;
+  size_t missed = options.short_window_size * sample_rate/4 - 1;
+  int failures = 0;
+  for (size_t i = 0; i < edge; i++) {
+    if (not sharpens_safely(i, N, i < missed, options)) failures++;
+    if (not sharpens_safely(N - 1 - i, N, i < missed, options)) failures++;
+  }
+  std::cout <<
+    "clicks within " << 1000 * edge/sample_rate << "ms of the edge of a frame: " <<
+    failures << " of " << 2 * edge << " failed" << std::endl;
+
+  return failures;
+}
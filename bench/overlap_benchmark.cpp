@@ -0,0 +1,122 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 2; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+size_t num_harmonics = 4;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+std::vector<double> tone(double fundamental) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (size_t h = 1; h <= num_harmonics; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+  }
+  return audio;
+}
+
+// Remove the least squares fit of a sinusoid
+// at freq from r, which starts at sample begin
+void remove_sinusoid(std::vector<double> & r, size_t begin, double freq) {
+  double w = 2 * M_PI * freq/sample_rate;
+  double cc = 0, ss = 0, cs = 0, xc = 0, xs = 0;
+  for (size_t i = 0; i < r.size(); i++) {
+    double c = std::cos(w * (begin + i)), s = std::sin(w * (begin + i));
+    cc += c * c; ss += s * s; cs += c * s;
+    xc += r[i] * c; xs += r[i] * s;
+  }
+  double det = cc * ss - cs * cs;
+  double a = (xc * ss - xs * cs)/det;
+  double b = (xs * cc - xc * cs)/det;
+  for (size_t i = 0; i < r.size(); i++) {
+    r[i] -= a * std::cos(w * (begin + i)) + b * std::sin(w * (begin + i));
+  }
+}
+
+double energy(const std::vector<double> & r) {
+  double e = 0;
+  for (double x : r) e += x * x;
+  return e;
+}
+
+// How far the middle half of the audio is from the closest sum
+// of sinusoids near each harmonic of fundamental, in dB.
+// Each harmonic lands within a padded bin of where it should,
+// so they are searched for separately.
+double snr(const std::vector<double> & audio, double fundamental) {
+  size_t begin = audio.size()/4, end = (3 * audio.size())/4;
+  std::vector<double> r(audio.begin() + begin, audio.begin() + end);
+  double signal = energy(r);
+
+  for (size_t h = 1; h <= num_harmonics; h++) {
+    double best = h * fundamental;
+    for (double step : {0.1, 0.005}) {
+      double center = best, best_residual = INFINITY;
+      for (int k = -20; k <= 20; k++) {
+        std::vector<double> trial = r;
+        remove_sinusoid(trial, begin, center + k * step);
+        double e = energy(trial);
+        if (e < best_residual) {
+          best_residual = e;
+          best = center + k * step;
+        }
+      }
+    }
+    remove_sinusoid(r, begin, best);
+  }
+
+  return 10 * std::log10(signal/energy(r));
+}
+
+int main() {
+  std::vector<double> left = tone(220);
+  std::vector<double> right = tone(330);
+
+  std::cout <<
+    "Transporting halfway between harmonic tones at 220Hz and 330Hz, " <<
+    "scored against the closest sinusoids near each harmonic of 275Hz" << std::endl;
+
+  for (unsigned int overlap : {1, 2, 4, 8}) {
+    std::vector<std::vector<audio_transport::spectral::point>> points_left, points_right, points_interpolated;
+    std::vector<double> audio;
+
+    double analysis_time = seconds([&] {
+      points_left = audio_transport::spectral::analysis(left, sample_rate, window_size, padding, overlap);
+      points_right = audio_transport::spectral::analysis(right, sample_rate, window_size, padding, overlap);
+    });
+    double interpolate_time = seconds([&] {
+      points_interpolated = audio_transport::interpolate(
+          points_left, points_right, window_size, audio_transport::constant_curve(0.5), overlap);
+    });
+    double synthesis_time = seconds([&] {
+      audio = audio_transport::spectral::synthesis(points_interpolated, padding, overlap);
+    });
+    double total = analysis_time + interpolate_time + synthesis_time;
+
+    std::cout <<
+      "overlap " << overlap << ": " <<
+      points_interpolated.size() << " frames, " <<
+      "analysis " << analysis_time << "s, " <<
+      "interpolate " << interpolate_time << "s, " <<
+      "synthesis " << synthesis_time << "s, " <<
+      total_time/total << "x realtime, " <<
+      "SNR " << snr(audio, 275) << "dB" << std::endl;
+  }
+}
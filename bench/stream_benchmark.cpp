@@ -0,0 +1,114 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/stream.hpp"
+#include "audio_transport/automation.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 4; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 3; // multiplies window size
+size_t block_size = 256; // samples per audio callback
+size_t ring_capacity = 4; // frames
+
+typedef std::chrono::steady_clock steady_clock;
+
+std::vector<double> tone(double fundamental) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (size_t h = 1; h <= 4; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+  }
+  return audio;
+}
+
+void pause() {
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+int main() {
+  using namespace audio_transport;
+
+  std::vector<double> left = tone(220);
+  std::vector<double> right = tone(330);
+
+  spectral::stream_analyzer left_analyzer(sample_rate, window_size, padding, 1, spectral::transform::automatic);
+  spectral::stream_analyzer right_analyzer(sample_rate, window_size, padding, 1, spectral::transform::automatic);
+  spectral::stream_synthesizer synthesizer(left_analyzer.fft_size(), padding, 1, spectral::transform::automatic);
+  stream_interpolator interpolator(left_analyzer.fft_size(), window_size);
+
+  size_t fft_size = left_analyzer.fft_size();
+  spectral::frame_ring<spectral::point> left_frames(ring_capacity, fft_size);
+  spectral::frame_ring<spectral::point> right_frames(ring_capacity, fft_size);
+  spectral::frame_ring<spectral::point> interpolated(ring_capacity, fft_size);
+  spectral::frame_ring<double> grains(ring_capacity, synthesizer.window_samples());
+
+  std::atomic<bool> running(true);
+
+  // Analysis, as if the inputs were arriving from disk.
+  // Writing nothing still pushes a frame held back by a full ring.
+  std::thread analysis([&] {
+      size_t l = 0, r = 0;
+      while (running) {
+        l += left_analyzer.write(&left[l], std::min(block_size, left.size() - l), left_frames);
+        r += right_analyzer.write(&right[r], std::min(block_size, right.size() - r), right_frames);
+        pause();
+      }
+    });
+
+  // Transport and the inverse transform
+  std::thread transport([&] {
+      breakpoint_curve interpolation({{0, 0}, {total_time, 1}});
+      while (running) {
+        interpolator.process(left_frames, right_frames, interpolated, interpolation);
+        while (interpolated.size() > 0 and grains.size() < grains.capacity()) {
+          synthesizer.synthesize(*interpolated.front(), *grains.reserve());
+          grains.push();
+          interpolated.pop();
+        }
+        pause();
+      }
+    });
+
+  // The audio callback, run in real time
+  std::vector<double> block(block_size);
+  size_t num_blocks = (sample_rate * total_time)/block_size;
+  double block_time = block_size/sample_rate;
+  double worst = 0, total = 0;
+
+  // Let the first frames through before starting
+  std::this_thread::sleep_for(std::chrono::duration<double>(2 * window_size));
+  steady_clock::time_point start = steady_clock::now();
+  for (size_t b = 0; b < num_blocks; b++) {
+    std::this_thread::sleep_until(start + std::chrono::duration_cast<steady_clock::duration>(
+          std::chrono::duration<double>(b * block_time)));
+
+    steady_clock::time_point callback = steady_clock::now();
+    synthesizer.read(block.data(), block_size, grains);
+    std::chrono::duration<double> elapsed = steady_clock::now() - callback;
+
+    worst = std::max(worst, elapsed.count());
+    total += elapsed.count();
+  }
+
+  running = false;
+  analysis.join();
+  transport.join();
+
+  std::cout <<
+    num_blocks << " callbacks of " << block_size << " samples (" <<
+    1000 * block_time << "ms): " <<
+    "mean " << 1e6 * total/num_blocks << "us, " <<
+    "worst " << 1e6 * worst << "us" << std::endl;
+  std::cout <<
+    "grain underruns " << grains.underruns() << ", " <<
+    "times analysis waited for room " << left_frames.overruns() + right_frames.overruns() << std::endl;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/transport_solver.hpp"
+#include "audio_transport/tonal.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 2; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A harmonic tone with some noise
+std::vector<double> tone(double fundamental, double noise) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (int h = 1; h <= 8; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+    audio[i] += noise * (std::rand()/(double) RAND_MAX - 0.5);
+  }
+  return audio;
+}
+
+int main() {
+  audio_transport::monotone_solver solver;
+
+  for (double noise : {0., 0.01, 0.1}) {
+    std::vector<std::vector<audio_transport::spectral::point>> left =
+      audio_transport::spectral::analysis(tone(220, noise), sample_rate, window_size, padding);
+    std::vector<std::vector<audio_transport::spectral::point>> right =
+      audio_transport::spectral::analysis(tone(330, noise), sample_rate, window_size, padding);
+    size_t num_windows = std::min(left.size(), right.size());
+
+    audio_transport::tonal_renderer tonal(left[0].size(), padding);
+
+    // Count the masses that take the fast path
+    size_t num_masses = 0, num_tonal = 0;
+    for (size_t w = 0; w < num_windows; w++) {
+      double total_magnitude = 0;
+      for (const audio_transport::spectral::point & p : left[w]) {
+        total_magnitude += std::abs(p.value);
+      }
+      for (const audio_transport::spectral_mass & mass : audio_transport::group_spectrum(left[w])) {
+        num_masses++;
+        if (tonal.is_tonal(mass, left[w], total_magnitude)) num_tonal++;
+      }
+    }
+
+    std::vector<std::vector<audio_transport::spectral::point>> dense(num_windows), fast(num_windows);
+    std::vector<double> dense_phases(left[0].size(), 0), fast_phases(left[0].size(), 0);
+    double dense_time = seconds([&] {
+      for (size_t w = 0; w < num_windows; w++) {
+        dense[w] = audio_transport::interpolate(
+            left[w], right[w], dense_phases, window_size, 0.5, solver);
+      }
+    });
+    double fast_time = seconds([&] {
+      for (size_t w = 0; w < num_windows; w++) {
+        fast[w] = audio_transport::interpolate(
+            left[w], right[w], fast_phases, window_size, 0.5, solver, tonal);
+      }
+    });
+
+    // Compare the magnitudes of the two renderings
+    double signal = 0, error = 0;
+    for (size_t w = 0; w < num_windows; w++) {
+      for (size_t i = 0; i < dense[w].size(); i++) {
+        double difference = std::abs(dense[w][i].value) - std::abs(fast[w][i].value);
+        signal += std::norm(dense[w][i].value);
+        error += difference * difference;
+      }
+    }
+
+    std::cout <<
+      "noise " << noise << ": " <<
+      num_tonal << "/" << num_masses << " masses tonal, " <<
+      "dense " << 1000 * dense_time/num_windows << "ms/frame, " <<
+      "tonal " << 1000 * fast_time/num_windows << "ms/frame, " <<
+      "magnitude SNR " << 10 * std::log10(signal/error) << "dB" <<
+      std::endl;
+  }
+}
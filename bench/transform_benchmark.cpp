@@ -0,0 +1,58 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+
+double total_time = 10; // seconds
+double window_size = 0.05; // seconds
+unsigned int overlap = 1;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main() {
+
+  for (double sample_rate : {44100., 48000.}) {
+
+    // Construct some noisy sines
+    std::vector<double> audio(sample_rate * total_time);
+    for (size_t i = 0; i < audio.size(); i++) {
+      double t = i/sample_rate;
+      audio[i] =
+        0.5 * std::sin(2 * M_PI * 220 * t) +
+        0.3 * std::sin(2 * M_PI * 1250 * t) +
+        0.01 * std::sin(2 * M_PI * 7919 * t * t);
+    }
+
+    for (unsigned int padding : {0u, 3u, 7u}) {
+      for (auto method : {
+          audio_transport::spectral::transform::padded,
+          audio_transport::spectral::transform::pruned}) {
+
+        std::vector<std::vector<audio_transport::spectral::point>> points;
+        double analysis_time = seconds([&] {
+          points = audio_transport::spectral::analysis(
+              audio, sample_rate, window_size, padding, overlap, method);
+        });
+        double synthesis_time = seconds([&] {
+          audio_transport::spectral::synthesis(points, padding, overlap, method);
+        });
+
+        std::cout <<
+          sample_rate << "Hz" <<
+          " padding " << padding <<
+          (method == audio_transport::spectral::transform::padded ? " padded" : " pruned") <<
+          ": analysis " << 1000 * analysis_time/points.size() << "ms/frame" <<
+          ", synthesis " << 1000 * synthesis_time/points.size() << "ms/frame" <<
+          std::endl;
+      }
+    }
+  }
+}
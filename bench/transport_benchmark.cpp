@@ -0,0 +1,88 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/transport_solver.hpp"
+
+double sample_rate = 44100; // samples per second
+double total_time = 2; // seconds
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A harmonic tone with a little noise
+std::vector<double> tone(double fundamental) {
+  std::vector<double> audio(sample_rate * total_time);
+  for (size_t i = 0; i < audio.size(); i++) {
+    double t = i/sample_rate;
+    for (int h = 1; h <= 8; h++) {
+      audio[i] += std::sin(2 * M_PI * h * fundamental * t)/h;
+    }
+    audio[i] += 0.01 * (std::rand()/(double) RAND_MAX - 0.5);
+  }
+  return audio;
+}
+
+int main() {
+
+  std::cout << "Analysing input" << std::endl;
+  std::vector<std::vector<audio_transport::spectral::point>> left =
+    audio_transport::spectral::analysis(tone(220), sample_rate, window_size, padding);
+  std::vector<std::vector<audio_transport::spectral::point>> right =
+    audio_transport::spectral::analysis(tone(330), sample_rate, window_size, padding);
+  size_t num_windows = std::min(left.size(), right.size());
+
+  audio_transport::sinkhorn_solver::options with_time;
+  with_time.time_weight = 1;
+
+  std::vector<std::pair<std::string, std::shared_ptr<audio_transport::transport_solver>>> solvers = {
+    {"monotone", std::make_shared<audio_transport::monotone_solver>()},
+    {"sinkhorn", std::make_shared<audio_transport::sinkhorn_solver>()},
+    {"sinkhorn (frequency, time)", std::make_shared<audio_transport::sinkhorn_solver>(with_time)}
+  };
+
+  for (auto & solver : solvers) {
+    size_t num_masses = 0, num_entries = 0;
+    double solve_time = 0;
+    for (size_t w = 0; w < num_windows; w++) {
+      std::vector<audio_transport::spectral_mass> left_masses =
+        audio_transport::group_spectrum(left[w]);
+      std::vector<audio_transport::spectral_mass> right_masses =
+        audio_transport::group_spectrum(right[w]);
+      num_masses += left_masses.size() + right_masses.size();
+
+      solve_time += seconds([&] {
+        num_entries += solver.second->solve(left_masses, right_masses, left[w], right[w]).size();
+      });
+    }
+
+    std::vector<double> phases(left[0].size(), 0);
+    double interpolate_time = seconds([&] {
+      for (size_t w = 0; w < num_windows; w++) {
+        audio_transport::interpolate(
+            left[w], right[w], phases, window_size, 0.5, *solver.second);
+      }
+    });
+
+    std::cout <<
+      solver.first << ": " <<
+      num_masses/(2. * num_windows) << " masses, " <<
+      num_entries/(double) num_windows << " plan entries, " <<
+      "solve " << 1000 * solve_time/num_windows << "ms/frame, " <<
+      "interpolate " << 1000 * interpolate_time/num_windows << "ms/frame" <<
+      std::endl;
+  }
+}
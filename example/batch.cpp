@@ -0,0 +1,419 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+#include <ciso646>
+#include <audiorw.hpp>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/equal_loudness.hpp"
+#include "audio_transport/context.hpp"
+#include "audio_transport/thread_pool.hpp"
+
+/**
+ * Renders every job in a manifest, one job per line:
+ *
+ *   transport left_file right_file output_file [option=value ...]
+ *   glide input_file output_file [option=value ...]
+ *
+ * Options:
+ *   window=0.05       analysis window in seconds
+ *   padding=7         multiplies window size
+ *   overlap=1         hops per half window
+ *   start=0 end=100   transport linearly between these percents
+ *   curve=0:0,1:1     or follow these (fraction of the output,
+ *                     interpolation factor) breakpoints instead
+ *   time_constant=100 glide time constant in milliseconds
+ *
+ * Everything after a '#' is ignored. Each input file is read
+ * and analysed once for all of the jobs that use it with the
+ * same window, padding and overlap.
+ */
+
+typedef std::vector<std::vector<audio_transport::spectral::point>> frames;
+
+// (fraction of the output, interpolation factor) pairs
+typedef std::vector<std::pair<double, double>> breakpoints;
+
+struct analysis {
+  double sample_rate;
+  double seconds;
+  std::vector<frames> channels;
+};
+
+struct job {
+  job() :
+    window_size(0.05),
+    padding(7),
+    overlap(1),
+    time_constant(100),
+    pending(0) {}
+
+  size_t line;
+  std::string mode;
+  std::vector<std::string> inputs;
+  std::string output;
+
+  double window_size; // seconds
+  unsigned int padding; // multiplies window size
+  unsigned int overlap; // hops per half window
+  breakpoints interpolation;
+  double time_constant; // milliseconds
+
+  // Filled in as the inputs are analysed
+  std::vector<std::shared_ptr<const analysis>> analyses;
+  std::atomic<size_t> pending;
+};
+
+// An input shared by one or more jobs
+struct source {
+  std::string file;
+  double window_size;
+  unsigned int padding;
+  unsigned int overlap;
+  // Each job and which of its inputs this is
+  std::vector<std::pair<job *, size_t>> readers;
+};
+
+struct statistics {
+  statistics() :
+    jobs_done(0), jobs_failed(0),
+    analysis_time(0), render_time(0), io_time(0),
+    seconds_in(0), seconds_out(0) {}
+
+  std::mutex mutex;
+  size_t jobs_done, jobs_failed;
+  // Seconds of CPU time spent in each stage
+  double analysis_time, render_time, io_time;
+  // Seconds of audio
+  double seconds_in, seconds_out;
+};
+
+audio_transport::context ctx;
+statistics stats;
+
+template <class Function>
+double seconds(Function f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void fail(const job & j, const std::string & message) {
+  std::lock_guard<std::mutex> lock(stats.mutex);
+  stats.jobs_failed++;
+  std::cerr << "line " << j.line << " (" << j.output << "): " << message << std::endl;
+}
+
+breakpoints parse_curve(const std::string & text) {
+  breakpoints c;
+  std::stringstream breakpoints(text);
+  std::string breakpoint;
+  while (std::getline(breakpoints, breakpoint, ',')) {
+    size_t colon = breakpoint.find(':');
+    if (colon == std::string::npos) {
+      throw std::runtime_error("curve breakpoints are fraction:factor");
+    }
+    c.emplace_back(
+        std::stod(breakpoint.substr(0, colon)),
+        std::stod(breakpoint.substr(colon + 1)));
+  }
+  if (c.empty()) throw std::runtime_error("empty curve");
+  std::sort(c.begin(), c.end());
+  return c;
+}
+
+std::unique_ptr<job> parse_job(const std::string & line) {
+  std::unique_ptr<job> j(new job);
+  std::stringstream tokens(line.substr(0, line.find('#')));
+  std::vector<std::string> positional;
+  double start = 0, end = 100;
+
+  std::string token;
+  while (tokens >> token) {
+    size_t equals = token.find('=');
+    if (equals == std::string::npos) {
+      positional.push_back(token);
+      continue;
+    }
+
+    std::string key = token.substr(0, equals);
+    std::string value = token.substr(equals + 1);
+    if (key == "window") {
+      j->window_size = std::stod(value);
+    } else if (key == "padding") {
+      j->padding = std::stoul(value);
+    } else if (key == "overlap") {
+      j->overlap = std::stoul(value);
+    } else if (key == "start") {
+      start = std::stod(value);
+    } else if (key == "end") {
+      end = std::stod(value);
+    } else if (key == "curve") {
+      j->interpolation = parse_curve(value);
+    } else if (key == "time_constant") {
+      j->time_constant = std::stod(value);
+    } else {
+      throw std::runtime_error("unknown option " + key);
+    }
+  }
+
+  if (positional.empty()) return nullptr;
+  j->mode = positional[0];
+
+  size_t num_inputs;
+  if (j->mode == "transport") {
+    num_inputs = 2;
+  } else if (j->mode == "glide") {
+    num_inputs = 1;
+  } else {
+    throw std::runtime_error("unknown mode " + j->mode);
+  }
+  if (positional.size() != num_inputs + 2) {
+    throw std::runtime_error(j->mode + " takes " + std::to_string(num_inputs) + " inputs and an output");
+  }
+
+  j->inputs.assign(positional.begin() + 1, positional.end() - 1);
+  j->output = positional.back();
+  j->analyses.resize(num_inputs);
+  j->pending = num_inputs;
+
+  if (j->window_size <= 0) throw std::runtime_error("window must be positive");
+  if (j->overlap < 1) throw std::runtime_error("overlap must be at least 1");
+  if (j->time_constant < 0) throw std::runtime_error("time_constant must be positive");
+  if (j->interpolation.empty()) {
+    if (start == end) throw std::runtime_error("start and end must differ");
+    j->interpolation = {{start/100., 0}, {end/100., 1}};
+  }
+
+  return j;
+}
+
+std::vector<std::vector<double>> transport(const job & j) {
+  const analysis & left = *j.analyses[0];
+  const analysis & right = *j.analyses[1];
+
+  size_t num_channels = std::min(left.channels.size(), right.channels.size());
+  std::vector<std::vector<double>> audio(num_channels);
+  for (size_t c = 0; c < num_channels; c++) {
+    const frames & points_left = left.channels[c];
+    const frames & points_right = right.channels[c];
+
+    // Place the breakpoints over the output
+    size_t num_windows = std::min(points_left.size(), points_right.size());
+    if (num_windows == 0) throw std::runtime_error("inputs are shorter than one window");
+    double begin = points_left[0][0].time;
+    double duration = points_left[num_windows - 1][0].time - begin;
+    breakpoints timed = j.interpolation;
+    for (std::pair<double, double> & breakpoint : timed) {
+      breakpoint.first = begin + breakpoint.first * duration;
+    }
+
+    frames points_interpolated =
+      audio_transport::interpolate(
+          ctx,
+          points_left,
+          points_right,
+          j.window_size,
+          audio_transport::breakpoint_curve(timed),
+          j.overlap);
+
+    audio_transport::equal_loudness::remove(points_interpolated);
+    audio[c] = audio_transport::spectral::synthesis(ctx, points_interpolated, j.padding, j.overlap);
+  }
+  return audio;
+}
+
+std::vector<std::vector<double>> glide(const job & j) {
+  const analysis & input = *j.analyses[0];
+  audio_transport::constant_curve time_constant(j.time_constant/1000.);
+
+  std::vector<std::vector<double>> audio(input.channels.size());
+  for (size_t c = 0; c < input.channels.size(); c++) {
+    frames points_interpolated =
+      audio_transport::glide(input.channels[c], j.window_size, time_constant, j.overlap);
+
+    audio_transport::equal_loudness::remove(points_interpolated);
+    audio[c] = audio_transport::spectral::synthesis(ctx, points_interpolated, j.padding, j.overlap);
+  }
+  return audio;
+}
+
+void render(job & j) {
+  try {
+    double sample_rate = j.analyses[0]->sample_rate;
+    for (const std::shared_ptr<const analysis> & a : j.analyses) {
+      if (a->sample_rate != sample_rate) {
+        throw std::runtime_error("sample rates are different");
+      }
+    }
+
+    std::vector<std::vector<double>> audio;
+    double render_time = seconds([&] {
+      audio = (j.mode == "transport") ? transport(j) : glide(j);
+    });
+    double io_time = seconds([&] {
+      audiorw::write(audio, j.output, sample_rate);
+    });
+
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    stats.jobs_done++;
+    stats.render_time += render_time;
+    stats.io_time += io_time;
+    if (not audio.empty()) stats.seconds_out += audio[0].size()/sample_rate;
+  } catch (const std::exception & e) {
+    fail(j, e.what());
+  }
+
+  // Free the inputs once no job needs them
+  j.analyses.clear();
+}
+
+void analyse(audio_transport::thread_pool & pool, const source & s) {
+  std::shared_ptr<analysis> result;
+  try {
+    std::shared_ptr<analysis> a(new analysis);
+    std::vector<std::vector<double>> audio;
+    double io_time = seconds([&] {
+      audio = audiorw::read(s.file, a->sample_rate);
+    });
+    if (audio.empty() or audio[0].empty()) {
+      throw std::runtime_error("no audio");
+    }
+    // Too short for a single frame
+    if (audio[0].size() < s.window_size * a->sample_rate) {
+      throw std::runtime_error("shorter than one window");
+    }
+
+    double analysis_time = seconds([&] {
+      for (const std::vector<double> & channel : audio) {
+        a->channels.push_back(
+            audio_transport::spectral::analysis(ctx, channel, a->sample_rate, s.window_size, s.padding, s.overlap));
+        audio_transport::equal_loudness::apply(a->channels.back());
+      }
+    });
+    a->seconds = audio[0].size()/a->sample_rate;
+
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    stats.analysis_time += analysis_time;
+    stats.io_time += io_time;
+    stats.seconds_in += a->seconds;
+    result = a;
+  } catch (const std::exception & e) {
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    std::cerr << s.file << ": " << e.what() << std::endl;
+  }
+
+  // Hand the analysis to the jobs that read it,
+  // rendering those that have all of their inputs
+  for (const std::pair<job *, size_t> & reader : s.readers) {
+    job * j = reader.first;
+    j->analyses[reader.second] = result;
+    if (--j->pending == 0) {
+      bool ready = std::all_of(
+          j->analyses.begin(), j->analyses.end(),
+          [](const std::shared_ptr<const analysis> & a) { return bool(a); });
+      if (ready) {
+        pool.submit([j] { render(*j); });
+      } else {
+        fail(*j, "could not analyse an input");
+        j->analyses.clear();
+      }
+    }
+  }
+}
+
+int main(int argc, char ** argv) {
+
+  if (argc != 2 and argc != 3) {
+    std::cout <<
+      "Usage: " << argv[0] << " manifest_file [num_threads]"
+      << std::endl;
+    return 1;
+  }
+
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  if (argc == 3) num_threads = std::atoi(argv[2]);
+
+  // Read the jobs
+  std::ifstream manifest(argv[1]);
+  if (not manifest) {
+    std::cout << "Could not open " << argv[1] << std::endl;
+    return 1;
+  }
+  std::vector<std::unique_ptr<job>> jobs;
+  std::string line;
+  for (size_t line_number = 1; std::getline(manifest, line); line_number++) {
+    std::unique_ptr<job> j;
+    try {
+      j = parse_job(line);
+    } catch (const std::exception & e) {
+      std::cout << argv[1] << ":" << line_number << ": " << e.what() << std::endl;
+      return 1;
+    }
+    if (not j) continue;
+    j->line = line_number;
+    jobs.push_back(std::move(j));
+  }
+
+  // Find the distinct analyses
+  std::vector<source> sources;
+  std::map<std::tuple<std::string, double, unsigned int, unsigned int>, size_t> source_index;
+  size_t num_reads = 0;
+  for (std::unique_ptr<job> & j : jobs) {
+    for (size_t i = 0; i < j->inputs.size(); i++) {
+      auto key = std::make_tuple(j->inputs[i], j->window_size, j->padding, j->overlap);
+      auto it = source_index.find(key);
+      if (it == source_index.end()) {
+        it = source_index.emplace(key, sources.size()).first;
+        sources.push_back(source{j->inputs[i], j->window_size, j->padding, j->overlap, {}});
+      }
+      sources[it->second].readers.emplace_back(j.get(), i);
+      num_reads++;
+    }
+  }
+
+  // Analyse everything, rendering
+  // each job as its inputs arrive
+  audio_transport::thread_pool pool(num_threads);
+  double wall_time = seconds([&] {
+    for (const source & s : sources) {
+      pool.submit([&pool, &s] { analyse(pool, s); });
+    }
+    pool.wait();
+  });
+
+  std::cout <<
+    stats.jobs_done << " jobs rendered, " <<
+    stats.jobs_failed << " failed, on " <<
+    pool.num_threads() << " threads in " << wall_time << "s" << std::endl;
+  std::cout <<
+    sources.size() << " analyses for " <<
+    num_reads << " inputs (" << num_reads - sources.size() << " shared), " <<
+    pool.steals() << " tasks stolen" << std::endl;
+  std::cout <<
+    stats.jobs_done/wall_time << " jobs/s, " <<
+    stats.seconds_in/wall_time << "x realtime analysis, " <<
+    stats.seconds_out/wall_time << "x realtime output" << std::endl;
+  std::cout <<
+    "thread time: analysis " << stats.analysis_time << "s, " <<
+    "render " << stats.render_time << "s, " <<
+    "io " << stats.io_time << "s" << std::endl;
+
+  return stats.jobs_failed > 0;
+}
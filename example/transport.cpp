@@ -1,19 +1,21 @@
 #include <iostream>
 #include <algorithm>
+#include <thread>
 #include <audiorw.hpp>
 
-#include "audio_transport/spectral.hpp"
-#include "audio_transport/audio_transport.hpp"
-#include "audio_transport/equal_loudness.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/memory.hpp"
+#include "audio_transport/context.hpp"
 
 double window_size = 0.05; // seconds
 unsigned int padding = 7; // multiplies window size
+unsigned int overlap = 1; // hops per half window
 
 int main(int argc, char ** argv) {
 
-  if (argc != 6) {
+  if (argc < 6 or argc > 8) {
     std::cout <<
-      "Usage: " << argv[0] << " left_file right_file start_percent end_percent output_file"
+      "Usage: " << argv[0] << " left_file right_file start_percent end_percent output_file [memory_budget_mb [num_threads]]"
       << std::endl;
     return 1;
   }
@@ -22,6 +24,14 @@ int main(int argc, char ** argv) {
   double start_fraction = std::atof(argv[3])/100.;
   double end_fraction = std::atof(argv[4])/100.;
 
+  // Stream channels that would need more than this (0 for no limit)
+  size_t memory_budget = argc >= 7 ? std::atof(argv[6]) * 1e6 : 0;
+
+  // Threads used within each stage of a channel
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  if (argc == 8) num_threads = std::atoi(argv[7]);
+  audio_transport::context ctx(num_threads);
+
   // Open the audio files
   double sample_rate_left;
   std::vector<std::vector<double>> audio_left =
@@ -37,50 +47,42 @@ int main(int argc, char ** argv) {
 
   // Initialize the output audio
   size_t num_channels = std::min(audio_left.size(), audio_right.size());
+  if (num_channels == 0) {
+    std::cout << "Could not read any audio from " << (audio_left.empty() ? argv[1] : argv[2]) << std::endl;
+    return 1;
+  }
   std::vector<std::vector<double>> audio_interpolated(num_channels);
 
-  // Iterate over the channels
-  for (size_t c = 0; c < num_channels; c++) {
-
-    std::cout << "Processing channel " << c << std::endl;
-
-    std::cout << "Converting left input to the spectral domain" << std::endl;
-    std::vector<std::vector<audio_transport::spectral::point>> points_left =
-      audio_transport::spectral::analysis(audio_left[c], sample_rate, window_size, padding);
-    std::cout << "Converting right input to the spectral domain" << std::endl;
-    std::vector<std::vector<audio_transport::spectral::point>> points_right =
-      audio_transport::spectral::analysis(audio_right[c], sample_rate, window_size, padding);
-
-    std::cout << "Applying equal loudness filters" << std::endl;
-    audio_transport::equal_loudness::apply(points_left);
-    audio_transport::equal_loudness::apply(points_right);
-
-    // Initialize phases
-    std::vector<double> phases(points_left[0].size(), 0);
-
-    std::cout << "Performing optimal transport based interpolation" << std::endl;
-    size_t num_windows = std::min(points_left.size(), points_right.size());
-    std::vector<std::vector<audio_transport::spectral::point>> points_interpolated(num_windows);
-    for (size_t w = 0; w < num_windows; w++) {
-      double interpolation_factor = w/(double) num_windows;
-      interpolation_factor = (interpolation_factor - start_fraction)/(end_fraction - start_fraction);
-      interpolation_factor = std::min(1.,std::max(0.,interpolation_factor));
-
-      points_interpolated[w] = 
-        audio_transport::interpolate(
-          points_left[w],
-          points_right[w],
-          phases,
-          window_size,
-          interpolation_factor);
-    }
+  // Say whether the channels fit in the budget
+  size_t num_samples = std::min(audio_left[0].size(), audio_right[0].size());
+  audio_transport::footprint predicted = audio_transport::predict_footprint(
+      num_samples, sample_rate, window_size, padding, overlap, ctx.num_threads());
+  std::cout << "Predicted peak memory per channel: " << predicted.peak/1e6 << "MB" << std::endl;
+  if (memory_budget > 0 and predicted.peak > memory_budget) {
+    audio_transport::footprint streaming = audio_transport::predict_streaming_footprint(
+        num_samples, sample_rate, window_size, padding, overlap);
+    std::cout << "Streaming instead, predicted peak memory per channel: " << streaming.peak/1e6 << "MB" << std::endl;
+  }
 
-    std::cout << "Removing equal loudness filters" << std::endl;
-    audio_transport::equal_loudness::remove(points_interpolated);
+  // Transport between the start and end percents of the input
+  double duration = num_samples/sample_rate;
+  audio_transport::breakpoint_curve interpolation_factor({
+      {start_fraction * duration, 0},
+      {end_fraction * duration, 1}});
 
-    std::cout << "Converting the interpolation to the time domain" << std::endl;
-    audio_interpolated[c] = 
-      audio_transport::spectral::synthesis(points_interpolated, padding);
+  // Iterate over the channels
+  for (size_t c = 0; c < num_channels; c++) {
+    std::cout << "Transporting channel " << c << std::endl;
+    audio_interpolated[c] = audio_transport::transport(
+        ctx,
+        audio_left[c],
+        audio_right[c],
+        sample_rate,
+        interpolation_factor,
+        window_size,
+        padding,
+        overlap,
+        memory_budget);
   }
 
   // Write the file
@@ -15,12 +15,153 @@ struct spectral_mass {
   double mass;
 };
 
+class transport_solver;
+class tonal_renderer;
+class curve;
+
+namespace spectral {
+class encoded_frame;
+}
+
+/**
+ * Interpolate one frame of spectral points. The phases carry over
+ * between consecutive frames, which are window_size/(2 * overlap)
+ * seconds apart for the overlap given to spectral::analysis.
+ */
+std::vector<audio_transport::spectral::point> interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    unsigned int overlap = 1);
+
+/**
+ * Interpolate using an alternative transport plan
+ * (see transport_solver.hpp).
+ */
 std::vector<audio_transport::spectral::point> interpolate(
     const std::vector<audio_transport::spectral::point> & left,
     const std::vector<audio_transport::spectral::point> & right,
     std::vector<double> & phases,
     double window_size,
-    double interpolation_factor);
+    double interpolation_factor,
+    const transport_solver & solver,
+    unsigned int overlap = 1);
+
+/**
+ * Interpolate rendering pairs of near-sinusoidal masses
+ * directly from their frequency and amplitude rather than
+ * shifting their bins (see tonal.hpp).
+ */
+std::vector<audio_transport::spectral::point> interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    const transport_solver & solver,
+    const tonal_renderer & tonal,
+    unsigned int overlap = 1);
+
+/**
+ * Interpolate every pair of frames, evaluating the interpolation
+ * factor at the center time of each frame (see automation.hpp)
+ * and clamping it to [0, 1].
+ */
+std::vector<std::vector<audio_transport::spectral::point>> interpolate(
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap = 1);
+
+/**
+ * The same, but placing the masses of each frame on the threads
+ * of ctx (see context.hpp). Frames still run one after the other,
+ * since each carries its phases over to the next.
+ */
+std::vector<std::vector<audio_transport::spectral::point>> interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap = 1);
+
+/**
+ * The same with an alternative transport plan, and rendering
+ * tonal masses directly (see tonal.hpp). Solvers and renderers
+ * are immutable so every thread shares them, and the output is
+ * still bit-identical at any number of threads.
+ */
+std::vector<std::vector<audio_transport::spectral::point>> interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    const transport_solver & solver,
+    unsigned int overlap = 1);
+
+std::vector<std::vector<audio_transport::spectral::point>> interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    const transport_solver & solver,
+    const tonal_renderer & tonal,
+    unsigned int overlap = 1);
+
+/**
+ * How glide turns its time constant into the step each hop
+ * moves towards the input.
+ */
+enum class glide_response {
+  // A hop of window_size/(2 overlap) seconds moves
+  // 1 - exp(-hop/time_constant) of the way, so the output
+  // follows the input with the same time constant at any
+  // window size or overlap
+  exponential,
+  // Earlier versions moved exp(-time_constant/window_size)
+  // of the way every window_size/2, so the same time constant
+  // glides for longer with shorter windows
+  window_relative
+};
+
+/**
+ * The glide effect. Each frame is interpolated from the previous
+ * output frame towards the input, so larger time constants (in
+ * seconds) slur the input's frequencies more. A time constant
+ * of 0 follows the input exactly.
+ */
+std::vector<std::vector<audio_transport::spectral::point>> glide(
+    const std::vector<std::vector<audio_transport::spectral::point>> & points,
+    double window_size,
+    const curve & time_constant,
+    unsigned int overlap = 1,
+    glide_response response = glide_response::exponential);
+
+/**
+ * Interpolate frames stored by encoded_frame (see codec.hpp),
+ * decoding them as they are grouped and placed. The output is
+ * not encoded.
+ */
+std::vector<audio_transport::spectral::point> interpolate(
+    const spectral::encoded_frame & left,
+    const spectral::encoded_frame & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    unsigned int overlap = 1);
+
+std::vector<std::vector<audio_transport::spectral::point>> interpolate(
+    const std::vector<spectral::encoded_frame> & left,
+    const std::vector<spectral::encoded_frame> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap = 1);
 
 std::vector<std::tuple<size_t, size_t, double>> transport_matrix(
     const std::vector<spectral_mass> & left,
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+namespace audio_transport {
+
+/**
+ * A parameter that changes over time, such as the interpolation
+ * factor. Times are in seconds on the same clock as
+ * spectral::point::time, so the engines evaluate a curve once per
+ * hop at the center of each frame rather than from a vector
+ * materialised for every frame.
+ * Curves are immutable so one can be shared across threads.
+ */
+class curve {
+ public:
+  virtual ~curve() {}
+
+  virtual double operator()(double time) const = 0;
+};
+
+class constant_curve : public curve {
+ public:
+  explicit constant_curve(double value) : value(value) {}
+
+  double operator()(double) const override { return value; }
+
+ private:
+  double value;
+};
+
+/**
+ * Straight lines between (time, value) breakpoints,
+ * holding the first and last values outside of them.
+ */
+class breakpoint_curve : public curve {
+ public:
+  explicit breakpoint_curve(std::vector<std::pair<double, double>> breakpoints);
+
+  double operator()(double time) const override;
+
+ private:
+  std::vector<std::pair<double, double>> breakpoints;
+};
+
+/**
+ * Cubic bezier segments through (time, value) control points:
+ *
+ *   p0, c0, c1, p1, c2, c3, p2, ...
+ *
+ * where the segment from p0 to p1 is shaped by c0 and c1.
+ * The control points of a segment must lie within the times of
+ * its ends so that each time has one value. Holds the first and
+ * last values outside of the curve.
+ */
+class bezier_curve : public curve {
+ public:
+  explicit bezier_curve(std::vector<std::pair<double, double>> control_points);
+
+  double operator()(double time) const override;
+
+ private:
+  std::vector<std::pair<double, double>> points;
+};
+
+/**
+ * Per-sample automation, such as a parameter stream from a host.
+ * The samples are not copied and must outlive the curve.
+ * Values between samples are linearly interpolated and
+ * the first and last values are held outside of them.
+ */
+class stream_curve : public curve {
+ public:
+  stream_curve(
+      const double * samples,
+      size_t num_samples,
+      double sample_rate,
+      double start_time = 0);
+
+  double operator()(double time) const override;
+
+ private:
+  const double * samples;
+  size_t num_samples;
+  double sample_rate;
+  double start_time;
+};
+
+}
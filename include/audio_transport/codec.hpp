@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "audio_transport/spectral.hpp"
+
+namespace audio_transport {
+namespace spectral {
+
+/**
+ * How encoded_frame stores magnitudes, relative to the
+ * loudest bin of the frame.
+ */
+enum class magnitude_format {
+  // IEEE half precision, 11 significant bits
+  half,
+  // Steps of 1/512 of an octave (about 0.012dB) down to
+  // about -770dB
+  log
+};
+
+struct codec_options {
+  codec_options() :
+    magnitudes(magnitude_format::log),
+    freq_resolution(1./1024),
+    time_resolution(1e-5),
+    floor(0) {}
+
+  magnitude_format magnitudes;
+  // The step of the reassigned frequencies (bins)
+  double freq_resolution;
+  // The step of the reassigned times (seconds)
+  double time_resolution;
+  // Bins quieter than this fraction of the loudest are
+  // dropped, and the indices of the rest are stored.
+  // 0 keeps every bin.
+  double floor;
+};
+
+/**
+ * A spectral frame stored in 8 bytes per bin rather than the 48
+ * of a point: a 16 bit magnitude, a 16 bit phase and the offsets
+ * of the reassigned frequency and time from the bin as 16 bit
+ * fixed point. With a floor the dropped bins cost nothing and
+ * the kept ones are found from the lengths of the runs of each,
+ * which take a few bytes per mass.
+ *
+ * Offsets beyond the range of the fixed point are clamped. No
+ * magnitude or offset is rounded to zero, so every mass keeps
+ * some weight and whether the reassigned frequency is above
+ * the bin, which decides how spectra are grouped into masses,
+ * is kept exactly.
+ *
+ * The fields are stored as separate arrays so they decode in
+ * straight loops. interpolate() reads encoded frames directly
+ * (see audio_transport.hpp), decoding only what grouping and
+ * placement use.
+ */
+class encoded_frame {
+ public:
+  encoded_frame();
+  encoded_frame(
+      const std::vector<point> & frame,
+      const codec_options & options = codec_options());
+
+  std::vector<point> decode() const;
+
+  /**
+   * Decode the magnitudes of every bin and copy the codes of
+   * their phases and frequency offsets, which phase() and
+   * freq_offset() convert. Dropped bins are zero.
+   */
+  void decode(
+      double * magnitudes,
+      uint16_t * phases,
+      int16_t * freq_offsets) const;
+
+  // The number of bins, including dropped ones
+  size_t size() const { return num_bins_; }
+  double time() const { return time_; }
+  // The frequency between bins (radians per second)
+  double bin_spacing() const { return bin_spacing_; }
+
+  double phase(uint16_t code) const { return code * phase_step; }
+  double freq_offset(int16_t code) const { return code * freq_step_; }
+
+  /**
+   * The bytes held by the frame.
+   */
+  size_t bytes() const;
+
+ private:
+  static const double phase_step;
+
+  size_t num_bins_;
+  double time_;
+  double bin_spacing_;
+  double peak_;
+  double freq_step_;
+  double time_step_;
+  magnitude_format format_;
+
+  std::vector<uint16_t> magnitudes_;
+  std::vector<uint16_t> phases_;
+  std::vector<int16_t> freq_offsets_;
+  std::vector<int16_t> time_offsets_;
+  // The lengths of alternating runs of dropped and kept
+  // bins as variable length integers, empty when every
+  // bin is kept
+  std::vector<uint8_t> indices_;
+
+  template <class Bin>
+  void for_each_bin(Bin bin) const;
+};
+
+std::vector<encoded_frame> encode(
+    const std::vector<std::vector<point>> & points,
+    const codec_options & options = codec_options());
+
+std::vector<std::vector<point>> decode(
+    const std::vector<encoded_frame> & frames);
+
+}
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <typeindex>
+#include <functional>
+#include <ciso646>
+
+namespace audio_transport {
+
+class thread_pool;
+
+/**
+ * Owns the state that analysis and synthesis reuse between calls:
+ * FFT plans, window tables, scratch workspaces and the number of
+ * threads to run on.
+ *
+ * Calls with separate contexts share nothing except FFTW's planner,
+ * which is serialised by spectral::fftw_planner_mutex. Calls that
+ * share a context are safe too. Plans and tables are immutable once
+ * they are built, and each thread checks out its own workspace.
+ */
+class context {
+ public:
+  explicit context(unsigned int num_threads = 1);
+  ~context();
+
+  context(const context &) = delete;
+  context & operator=(const context &) = delete;
+
+  /**
+   * The number of threads a single call may use.
+   */
+  unsigned int num_threads() const { return num_threads_; }
+  void set_num_threads(unsigned int num_threads);
+
+  /**
+   * Whether calls give bit-identical output at any number of
+   * threads, as they do by default. Each thread then owns a
+   * range of the output and adds to it in the order a single
+   * thread would, redoing the work at the edges of its range.
+   * Otherwise threads add their share of the output as they
+   * finish, which rounds differently from run to run.
+   */
+  bool deterministic() const { return deterministic_; }
+  void set_deterministic(bool deterministic);
+
+  /**
+   * Release every cached plan, table and idle workspace.
+   * Calls in flight keep what they are using.
+   */
+  void clear();
+
+  /**
+   * The bytes held by the cached plans, tables and workspaces,
+   * leased or idle, as each reports them. Every thread that ran
+   * a call at once checked out a workspace of its own, so there
+   * are as many of those as threads that have been busy at once.
+   */
+  size_t bytes() const { return bytes_; }
+
+  /**
+   * What a cached object was built for:
+   * window samples, padding, overlap and sample rate.
+   */
+  typedef std::tuple<size_t, unsigned int, unsigned int, double> signature;
+
+  /**
+   * Exclusive use of a workspace until the lease is destroyed.
+   */
+  template <class T>
+  class lease {
+   public:
+    lease(context & ctx, const signature & s, std::shared_ptr<T> item) :
+      ctx(&ctx), s(s), item(std::move(item)) {}
+    lease(lease && other) :
+      ctx(other.ctx), s(other.s), item(std::move(other.item)) {}
+    ~lease() {
+      if (item) {
+        size_t bytes = item->bytes();
+        ctx->release(typeid(T), s, std::move(item), bytes);
+      }
+    }
+
+    T & operator*() const { return *item; }
+    T * operator->() const { return item.get(); }
+
+   private:
+    context * ctx;
+    signature s;
+    std::shared_ptr<T> item;
+  };
+
+  /**
+   * Find or build an immutable object shared by every caller.
+   * make() returns a new T, which reports its size with bytes().
+   */
+  template <class T, class Factory>
+  std::shared_ptr<const T> shared(const signature & s, Factory make) {
+    std::shared_ptr<const void> found = find(typeid(T), s);
+    if (not found) {
+      // Build outside of the lock, a racing
+      // thread may get there first
+      std::shared_ptr<const T> item(make());
+      found = insert(typeid(T), s, item, item->bytes());
+    }
+    return std::static_pointer_cast<const T>(found);
+  }
+
+  /**
+   * Check out an idle workspace or build a new one.
+   * make() returns a new T, which reports its size with bytes().
+   */
+  template <class T, class Factory>
+  lease<T> acquire(const signature & s, Factory make) {
+    std::shared_ptr<void> item = take(typeid(T), s);
+    if (not item) {
+      std::shared_ptr<T> made(make());
+      bytes_ += made->bytes();
+      item = made;
+    }
+    return lease<T>(*this, s, std::static_pointer_cast<T>(item));
+  }
+
+  /**
+   * Run f on contiguous ranges of [0, n) using up
+   * to num_threads() threads including this one.
+   * The others are workers the context keeps between
+   * calls. Calls from those workers run on one thread.
+   * Rethrows the first exception f throws.
+   */
+  void parallel_for(
+      size_t n,
+      const std::function<void(size_t begin, size_t end)> & f) const;
+
+ private:
+  typedef std::pair<std::type_index, signature> key;
+
+  std::shared_ptr<const void> find(std::type_index type, const signature & s);
+  std::shared_ptr<const void> insert(
+      std::type_index type,
+      const signature & s,
+      std::shared_ptr<const void> item,
+      size_t bytes);
+  std::shared_ptr<void> take(std::type_index type, const signature & s);
+  void release(
+      std::type_index type,
+      const signature & s,
+      std::shared_ptr<void> item,
+      size_t bytes);
+
+  std::atomic<unsigned int> num_threads_;
+  std::atomic<bool> deterministic_;
+
+  // num_threads() - 1 workers, started by the first
+  // call that needs them and kept by calls in flight
+  // when the number of threads changes
+  std::shared_ptr<thread_pool> workers(unsigned int num_threads) const;
+  mutable std::mutex workers_mutex;
+  mutable std::shared_ptr<thread_pool> workers_;
+
+  std::mutex mutex;
+  // Each with its size in bytes
+  std::map<key, std::pair<std::shared_ptr<const void>, size_t>> resources;
+  std::map<key, std::vector<std::pair<std::shared_ptr<void>, size_t>>> idle;
+  std::atomic<size_t> bytes_;
+};
+
+/**
+ * The single threaded context used by the
+ * functions that do not take one.
+ */
+context & default_context();
+
+}
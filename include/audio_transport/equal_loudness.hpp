@@ -14,4 +14,10 @@ void apply(
 void remove(
     std::vector<std::vector<spectral::point>> & points);
 
+// A single frame
+void apply(
+    std::vector<spectral::point> & frame);
+void remove(
+    std::vector<spectral::point> & frame);
+
 }}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <complex>
+#include <memory>
+#include <mutex>
+
+namespace audio_transport {
+namespace spectral {
+
+/**
+ * FFTW's planner is not thread safe, so every plan in
+ * this library is created and destroyed while holding
+ * this lock. Applications that plan with FFTW on other
+ * threads should take it too.
+ */
+std::mutex & fftw_planner_mutex();
+
+/**
+ * Transforms over entire zero-padded frames.
+ * Same interface as pruned_fft.
+ */
+class padded_fft {
+ public:
+  /**
+   * Scratch space for one caller at a time.
+   * The transform itself is immutable, so threads can
+   * share it as long as they each use their own workspace.
+   */
+  class workspace {
+   public:
+    explicit workspace(const padded_fft & transform);
+
+    // The bytes of its buffers
+    size_t bytes() const { return bytes_; }
+
+   private:
+    friend class padded_fft;
+
+    size_t bytes_;
+
+    struct deleter { void operator()(void * p) const; };
+    typedef std::unique_ptr<std::complex<double>[], deleter> complex_buffer;
+    typedef std::unique_ptr<double[], deleter> real_buffer;
+
+    // The padded frames, zero outside their center
+    real_buffer window, window_t, window_d;
+    complex_buffer fft, fft_t, fft_d;
+    // The padded output of the inverse
+    real_buffer output;
+  };
+
+  padded_fft(size_t window_samples, unsigned int padding);
+  ~padded_fft();
+
+  padded_fft(const padded_fft &) = delete;
+  padded_fft & operator=(const padded_fft &) = delete;
+
+  size_t window_samples() const { return N; }
+  unsigned int padding() const { return padding_; }
+  size_t fft_size() const { return N_padded/2 + 1; }
+
+  /**
+   * The bytes held by the transform. FFTW does not report
+   * the size of its plans, which are taken to hold about
+   * as much as the input and output they transform.
+   */
+  size_t bytes() const;
+
+  /**
+   * Compute the fft_size() bins of the transforms of three
+   * window_samples long frames centered in the padding.
+   */
+  void forward(
+      const double * x,
+      const double * x_t,
+      const double * x_d,
+      std::complex<double> * X,
+      std::complex<double> * X_t,
+      std::complex<double> * X_d,
+      workspace & w) const;
+
+  /**
+   * Compute the window_samples samples at the center of the
+   * unnormalized inverse transform of fft_size() bins.
+   */
+  void inverse(
+      const std::complex<double> * X,
+      double * x,
+      workspace & w) const;
+
+ private:
+  struct plans;
+
+  size_t N;
+  unsigned int padding_;
+  size_t N_padded;
+  size_t padding_samples;
+
+  std::unique_ptr<plans> plans_;
+};
+
+}}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cassert>
+
+namespace audio_transport {
+namespace spectral {
+
+/**
+ * A fixed number of preallocated frames passed from one
+ * producer thread to one consumer thread without locks.
+ *
+ * The producer fills the frame returned by reserve() and
+ * publishes it with push(). The consumer reads the frame
+ * returned by front() and releases it with pop(). Neither
+ * side allocates or blocks, so either may be a real-time
+ * thread.
+ *
+ * reserve() returns nullptr when the ring is full so the
+ * producer can hold back (backpressure), and front() returns
+ * nullptr when it is empty. Each of those is counted as an
+ * overrun or underrun. Check size() first to poll without
+ * counting.
+ *
+ * Spectral frames are frame_ring<point> with fft_size()
+ * points each. frame_ring<double> carries audio.
+ */
+template <class T>
+class frame_ring {
+ public:
+  frame_ring(size_t capacity, size_t frame_size) :
+    frames(capacity, std::vector<T>(frame_size)) {
+    assert(capacity > 0);
+  }
+
+  frame_ring(const frame_ring &) = delete;
+  frame_ring & operator=(const frame_ring &) = delete;
+
+  size_t capacity() const { return frames.size(); }
+  size_t frame_size() const { return frames[0].size(); }
+
+  /**
+   * The bytes held by the frames.
+   */
+  size_t bytes() const {
+    return frames.capacity() * sizeof(std::vector<T>) +
+      frames.size() * frames[0].capacity() * sizeof(T);
+  }
+
+  /**
+   * The number of frames pushed but not popped.
+   */
+  size_t size() const {
+    // Load the read count first so it cannot pass the write count
+    size_t r = read.count.load(std::memory_order_acquire);
+    return written.count.load(std::memory_order_acquire) - r;
+  }
+
+  // Producer
+
+  std::vector<T> * reserve() {
+    size_t w = written.count.load(std::memory_order_relaxed);
+    if (w - read.count.load(std::memory_order_acquire) == frames.size()) {
+      written.failures.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &frames[w % frames.size()];
+  }
+
+  void push() {
+    written.count.fetch_add(1, std::memory_order_release);
+  }
+
+  // Consumer
+
+  const std::vector<T> * front() {
+    size_t r = read.count.load(std::memory_order_relaxed);
+    if (written.count.load(std::memory_order_acquire) == r) {
+      read.failures.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &frames[r % frames.size()];
+  }
+
+  void pop() {
+    read.count.fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * The number of times reserve() found the
+   * ring full and front() found it empty.
+   */
+  size_t overruns() const { return written.failures.load(std::memory_order_relaxed); }
+  size_t underruns() const { return read.failures.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<std::vector<T>> frames;
+
+  // The counts kept by each side. Padding keeps them on
+  // separate cache lines so the two threads do not
+  // invalidate each other.
+  struct counts {
+    counts() : count(0), failures(0) {}
+
+    std::atomic<size_t> count;
+    std::atomic<size_t> failures;
+    char padding[64];
+  };
+
+  counts written;
+  counts read;
+};
+
+}}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "audio_transport/spectral.hpp"
+
+namespace audio_transport {
+
+class curve;
+
+/**
+ * The bytes held while transporting one channel, by stage.
+ *
+ * audio is the input and output samples, held throughout, and
+ * cached what the context already held from earlier calls.
+ * The stages count their own buffers: analysis the spectra of
+ * both inputs, interpolation the interpolated spectra and
+ * synthesis its scratch, along with the plans, windows and
+ * per-thread workspaces they add to the context. peak is the
+ * most held at once, including what is still kept from earlier
+ * stages.
+ */
+struct footprint {
+  footprint() :
+    audio(0),
+    cached(0),
+    analysis(0),
+    interpolation(0),
+    synthesis(0),
+    peak(0) {}
+
+  size_t audio;
+  size_t cached;
+  size_t analysis;
+  size_t interpolation;
+  size_t synthesis;
+  size_t peak;
+};
+
+/**
+ * Predict the footprint of analysing two inputs of num_samples
+ * samples, interpolating every frame and synthesising the
+ * result, as transport() does without a memory budget, on a
+ * fresh context with num_threads threads. Most of it is the
+ * spectra, which grow with the length of the input and with
+ * padding and overlap. FFTW's plans are estimated to hold
+ * about as much as the arrays they transform.
+ */
+footprint predict_footprint(
+    size_t num_samples,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    unsigned int num_threads = 1);
+
+/**
+ * The same for a render through the streaming API (see
+ * stream.hpp), which only holds a few frames at a time so
+ * every stage runs at once and only the audio grows with
+ * the length of the input.
+ */
+footprint predict_streaming_footprint(
+    size_t num_samples,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1);
+
+/**
+ * Transport from the left audio to the right, evaluating the
+ * interpolation factor at the center of each frame like the
+ * frame sequence interpolate. Like the transport binary, the
+ * spectra are weighted for equal loudness while they are
+ * interpolated (see equal_loudness.hpp).
+ *
+ * Everything is analysed before it is interpolated unless that
+ * is predicted to hold more than memory_budget bytes (0 for no
+ * budget), in which case the audio is streamed a frame at a
+ * time instead. Both produce the same audio.
+ *
+ * If counted is given it receives the footprint counted from
+ * the capacities of the spectra and buffers the render kept and
+ * the bytes the context gained for it (see context::bytes),
+ * which counts every thread's workspace. The inside of FFTW's
+ * plans and interpolate's scratch for a frame are the
+ * prediction's estimates, and other calls sharing the context
+ * at the same time are counted too.
+ *
+ * Inputs too short for a single frame give no audio.
+ */
+std::vector<double> transport(
+    const std::vector<double> & left,
+    const std::vector<double> & right,
+    double sample_rate,
+    const curve & interpolation_factor,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    size_t memory_budget = 0, // bytes
+    footprint * counted = nullptr);
+
+/**
+ * The same, but sharing the plans cached in ctx and running
+ * each stage on its threads.
+ */
+std::vector<double> transport(
+    context & ctx,
+    const std::vector<double> & left,
+    const std::vector<double> & right,
+    double sample_rate,
+    const curve & interpolation_factor,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    size_t memory_budget = 0, // bytes
+    footprint * counted = nullptr);
+
+}
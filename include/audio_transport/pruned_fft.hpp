@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <memory>
+
+namespace audio_transport {
+namespace spectral {
+
+/**
+ * Transforms of zero-padded frames that never touch the padding.
+ *
+ * A frame of N samples padded to N * (1 + padding) samples has
+ * a spectrum whose bins k = (1 + padding) * m + r are the N-point
+ * transform of the frame modulated by exp(-2 pi i r n/N_padded).
+ * The forward transform computes each residue r with a window
+ * sized FFT, and the inverse uses the same decomposition to
+ * produce only the N samples that synthesis keeps. Conjugate
+ * symmetry means only about half of the residues are needed.
+ */
+class pruned_fft {
+ public:
+  /**
+   * Scratch space for one caller at a time.
+   * The transform itself is immutable, so threads can
+   * share it as long as they each use their own workspace.
+   */
+  class workspace {
+   public:
+    explicit workspace(const pruned_fft & fft);
+
+    // The bytes of its buffers
+    size_t bytes() const { return bytes_; }
+
+   private:
+    friend class pruned_fft;
+
+    size_t bytes_;
+
+    struct deleter { void operator()(void * p) const; };
+    typedef std::unique_ptr<std::complex<double>[], deleter> complex_buffer;
+    typedef std::unique_ptr<double[], deleter> real_buffer;
+
+    complex_buffer input;
+    complex_buffer output;
+    // The transform of every residue of x + i x_t
+    complex_buffer residues;
+    // The transform of the lower residues of x_d
+    complex_buffer residues_d;
+    real_buffer real;
+  };
+
+  pruned_fft(size_t window_samples, unsigned int padding);
+  ~pruned_fft();
+
+  pruned_fft(const pruned_fft &) = delete;
+  pruned_fft & operator=(const pruned_fft &) = delete;
+
+  size_t window_samples() const { return N; }
+  unsigned int padding() const { return L - 1; }
+  size_t fft_size() const { return N * L/2 + 1; }
+
+  /**
+   * The bytes held by the transform, with its window sized
+   * plans estimated like those of padded_fft.
+   */
+  size_t bytes() const;
+
+  /**
+   * Compute the fft_size() bins of the transforms of three
+   * window_samples long frames centered in the padding.
+   * Matches a real-to-complex FFT of the padded frames.
+   */
+  void forward(
+      const double * x,
+      const double * x_t,
+      const double * x_d,
+      std::complex<double> * X,
+      std::complex<double> * X_t,
+      std::complex<double> * X_d,
+      workspace & w) const;
+
+  /**
+   * Compute the window_samples samples at the center of the
+   * unnormalized inverse transform of fft_size() bins.
+   * Matches the center of a complex-to-real FFT.
+   */
+  void inverse(
+      const std::complex<double> * X,
+      double * x,
+      workspace & w) const;
+
+ private:
+  struct plans;
+
+  size_t N;
+  size_t L;
+
+  // exp(-2 pi i r n/N_padded) for every residue r
+  std::vector<std::complex<double>> twiddles;
+  // exp(-2 pi i k padding_samples/N_padded), periodic in 2L
+  std::vector<std::complex<double>> shifts;
+
+  std::unique_ptr<plans> plans_;
+};
+
+}}
@@ -4,6 +4,9 @@
 #include <complex>
 
 namespace audio_transport {
+
+class context;
+
 namespace spectral {
 
 struct point {
@@ -16,16 +19,35 @@ struct point {
   double freq_reassigned;
 };
 
+/**
+ * How the zero-padded frames are transformed. The default is
+ * padded, which gives the same output as earlier versions.
+ * pruned, and automatic when it prunes, differ from it by
+ * rounding (around 1e-12 of the loudest bin), so they are
+ * for callers who do not need bit-identical output.
+ */
+enum class transform {
+  // FFTs over the entire padded frame
+  padded,
+  // Window sized FFTs that skip the padding
+  // (see pruned_fft.hpp)
+  pruned,
+  // Pruned when the padding is large enough to pay off
+  automatic
+};
+
 /**
  * Analyze an audio signal to produce an array of spectral points.
- * Points are reduced to mono.
+ * Points are reduced to mono. Audio shorter than a window gives
+ * no frames, and no frames synthesize no audio.
  */
 std::vector<std::vector<point>> analysis(
     const std::vector<double> & audio,
     double sample_rate,
     double window_size = 0.05, // seconds
     unsigned int padding = 0,
-    unsigned int overlap = 1
+    unsigned int overlap = 1,
+    transform method = transform::padded
     );
 
 /**
@@ -34,7 +56,91 @@ std::vector<std::vector<point>> analysis(
 std::vector<double> synthesis(
     const std::vector<std::vector<point>> & points,
     unsigned int padding = 0,
-    unsigned int overlap = 1
+    unsigned int overlap = 1,
+    transform method = transform::padded
+    );
+
+/**
+ * The same as above, but reusing the plans, tables and
+ * workspaces cached in ctx and running on its threads.
+ * The overloads without a context use default_context().
+ */
+std::vector<std::vector<point>> analysis(
+    context & ctx,
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    transform method = transform::padded
+    );
+
+std::vector<double> synthesis(
+    context & ctx,
+    const std::vector<std::vector<point>> & points,
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    transform method = transform::padded
+    );
+
+/**
+ * How multiresolution_analysis finds and sharpens transients.
+ */
+struct multiresolution_options {
+  multiresolution_options() :
+    short_window_size(0.01),
+    crossover(1000),
+    max_time_spread(0.0025),
+    max_freq_deviation(0.25),
+    min_energy(0.01) {}
+
+  // The window used at transients (seconds)
+  double short_window_size;
+  // Only bins above this frequency are replaced (Hz)
+  double crossover;
+  // A frame holds a transient when the energy above the
+  // crossover has reassigned times within this spread of
+  // each other (seconds) ...
+  double max_time_spread;
+  // ... and reassigned frequencies within this many
+  // unpadded bins of their own bins, as an impulse does
+  // and a sinusoid or noise does not ...
+  double max_freq_deviation;
+  // ... and is at least this fraction of the frame's energy
+  double min_energy;
+};
+
+/**
+ * Analysis with a long window that switches to a short one
+ * where it would smear a transient.
+ *
+ * Each frame is analysed as by analysis(). When the reassigned
+ * times and frequencies of the bins above the crossover show
+ * a transient, those bins are replaced by the spectrum of a
+ * short window centered on it. The short window is transformed
+ * on the same padded grid and scaled by the long window at the
+ * transient, so synthesis() still reconstructs it. Only the
+ * frames with transients pay for the second transform.
+ */
+std::vector<std::vector<point>> multiresolution_analysis(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    multiresolution_options options = multiresolution_options(),
+    transform method = transform::padded
+    );
+
+std::vector<std::vector<point>> multiresolution_analysis(
+    context & ctx,
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1,
+    multiresolution_options options = multiresolution_options(),
+    transform method = transform::padded
     );
 
 /**
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <ciso646>
+
+#include "audio_transport/spectral.hpp"
+
+namespace audio_transport {
+namespace spectral {
+namespace kernel {
+
+/**
+ * Frame geometry that is only known at run time.
+ * This is the generic fallback used for any
+ * window/padding/overlap combination.
+ */
+struct dynamic_config {
+  dynamic_config(
+      size_t window_samples,
+      unsigned int padding,
+      unsigned int overlap) :
+    window_samples_(window_samples),
+    padding_(padding),
+    overlap_(overlap) {}
+
+  size_t window_samples() const { return window_samples_; }
+  unsigned int padding() const { return padding_; }
+  unsigned int overlap() const { return overlap_; }
+
+  size_t padded_samples() const { return window_samples_ * (1 + padding_); }
+  size_t padding_samples() const { return (padded_samples() - window_samples_)/2; }
+  // Accounting for an overlap factor of 2 * overlap
+  size_t hop_samples() const { return window_samples_/(2 * overlap_); }
+  size_t fft_size() const { return padded_samples()/2 + 1; }
+
+  typedef std::vector<double> table;
+  table make_table() const { return table(window_samples_); }
+
+ private:
+  size_t window_samples_;
+  unsigned int padding_;
+  unsigned int overlap_;
+};
+
+/**
+ * Frame geometry fixed at compile time.
+ * Every size is a constant expression so the
+ * windowing and overlap-add loops have fixed
+ * trip counts and the window tables have a
+ * fixed size.
+ */
+template <size_t N, unsigned int Padding, unsigned int Overlap>
+struct static_config {
+  static_assert(N % (2 * Overlap) == 0,
+      "the window must split into a whole number of hops");
+
+  static constexpr size_t window_samples() { return N; }
+  static constexpr unsigned int padding() { return Padding; }
+  static constexpr unsigned int overlap() { return Overlap; }
+
+  static constexpr size_t padded_samples() { return N * (1 + Padding); }
+  static constexpr size_t padding_samples() { return (N * Padding)/2; }
+  static constexpr size_t hop_samples() { return N/(2 * Overlap); }
+  static constexpr size_t fft_size() { return padded_samples()/2 + 1; }
+
+  typedef std::array<double, N> table;
+  static table make_table() { return table(); }
+};
+
+// The bytes a table holds outside of itself
+inline size_t heap_bytes(const std::vector<double> & table) {
+  return table.capacity() * sizeof(double);
+}
+
+template <size_t N>
+size_t heap_bytes(const std::array<double, N> &) {
+  return 0;
+}
+
+/**
+ * The analysis windows evaluated once per frame geometry
+ * instead of once per sample per frame.
+ */
+template <class Config>
+struct windows {
+  windows(const Config & config, double sample_rate) :
+    hann  (config.make_table()),
+    hann_t(config.make_table()),
+    hann_d(config.make_table()) {
+    const size_t N = config.window_samples();
+    for (size_t i = 0; i < N; i++) {
+      // The sample index of with window
+      // if the center of the window has n = 0
+      double n = i - (N - 1)/2.;
+
+      hann  [i] = spectral::hann  (n, N);
+      hann_t[i] = spectral::hann_t(n, N, sample_rate);
+      hann_d[i] = spectral::hann_d(n, N, sample_rate);
+    }
+  }
+
+  size_t bytes() const {
+    return sizeof(*this) + heap_bytes(hann) + heap_bytes(hann_t) + heap_bytes(hann_d);
+  }
+
+  typename Config::table hann;
+  typename Config::table hann_t;
+  typename Config::table hann_d;
+};
+
+/**
+ * Window a frame of audio into the three FFT inputs.
+ * For padded transforms the outputs point at the
+ * non-zero region of the padded frames.
+ */
+template <class Config>
+void apply_windows(
+    const Config & config,
+    const windows<Config> & w,
+    const double * audio,
+    double * x,
+    double * x_t,
+    double * x_d) {
+  const size_t N = config.window_samples();
+  for (size_t i = 0; i < N; i++) {
+    double a = audio[i];
+    x  [i] = a * w.hann  [i];
+    x_t[i] = a * w.hann_t[i];
+    x_d[i] = a * w.hann_d[i];
+  }
+}
+
+/**
+ * Turn the three transforms of a frame into
+ * reassigned spectral points, from first_bin up.
+ */
+template <class Config>
+void reassign(
+    const Config & config,
+    const std::complex<double> * X,
+    const std::complex<double> * X_t,
+    const std::complex<double> * X_d,
+    double time,
+    double sample_rate,
+    point * points,
+    size_t first_bin = 0) {
+  const size_t fft_size = config.fft_size();
+  const double N_padded = config.padded_samples();
+  for (size_t i = first_bin; i < fft_size; i++) {
+    point & p = points[i];
+    p.value = X[i];
+    p.time = time;
+    p.freq = (2 * M_PI * i * sample_rate)/N_padded;
+
+    // Compute how the frequency and time changed
+    std::complex<double> conj_over_norm = std::conj(X[i])/std::norm(X[i]);
+    double dphase_domega =  std::real(X_t[i] * conj_over_norm);
+    double dphase_dt     = -std::imag(X_d[i] * conj_over_norm);
+
+    // Compute the reassigned time and frequency
+    p.time_reassigned = p.time + dphase_domega;
+    p.freq_reassigned = p.freq + dphase_dt;
+  }
+}
+
+/**
+ * Add the samples [begin, end) of an inverse transformed
+ * frame onto the output audio.
+ */
+template <class Config>
+void overlap_add(
+    const Config & config,
+    const double * frame,
+    double * audio,
+    size_t begin,
+    size_t end) {
+  // Scale down to correct for FFT and overlap sizes
+  const double scale = config.overlap() * config.padded_samples();
+  for (size_t i = begin; i < end; i++) {
+    audio[i] += frame[i]/scale;
+  }
+}
+
+/**
+ * Add the kept window_samples of an inverse
+ * transformed frame onto the output audio.
+ */
+template <class Config>
+void overlap_add(
+    const Config & config,
+    const double * frame,
+    double * audio) {
+  overlap_add(config, frame, audio, 0, config.window_samples());
+}
+
+/**
+ * A list of the frame geometries that
+ * get their own specialised kernels.
+ */
+template <class ... Configs>
+struct registry {};
+
+/**
+ * Call f with the registered configuration matching
+ * the given geometry, or with a dynamic_config if
+ * none of them match.
+ */
+template <class Function>
+typename Function::result_type dispatch(
+    registry<>,
+    size_t window_samples,
+    unsigned int padding,
+    unsigned int overlap,
+    const Function & f) {
+  return f(dynamic_config(window_samples, padding, overlap));
+}
+
+template <class Config, class ... Rest, class Function>
+typename Function::result_type dispatch(
+    registry<Config, Rest...>,
+    size_t window_samples,
+    unsigned int padding,
+    unsigned int overlap,
+    const Function & f) {
+  if (window_samples == Config::window_samples() and
+      padding == Config::padding() and
+      overlap == Config::overlap()) {
+    return f(Config());
+  }
+  return dispatch(registry<Rest...>(), window_samples, padding, overlap, f);
+}
+
+/**
+ * The geometries used in production.
+ * A 50ms window rounds to 2206 samples at 44.1kHz
+ * and 2400 samples at 48kHz.
+ */
+typedef registry<
+  static_config<2206, 7, 1>,
+  static_config<2400, 7, 1>
+  > registered;
+
+}}}
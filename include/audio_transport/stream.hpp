@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/frame_ring.hpp"
+
+namespace audio_transport {
+
+class curve;
+
+namespace spectral {
+
+/**
+ * Analysis of audio that arrives a block at a time, such as
+ * the input of a plugin. It produces the same frames as
+ * analysis() would for everything written so far, one every
+ * hop once a whole window has been written.
+ *
+ * write() never allocates or locks, so it can run on the
+ * audio thread. The analyzer itself is used by one thread
+ * at a time.
+ */
+class stream_analyzer {
+ public:
+  stream_analyzer(
+      double sample_rate,
+      double window_size = 0.05, // seconds
+      unsigned int padding = 0,
+      unsigned int overlap = 1,
+      transform method = transform::padded);
+
+  /**
+   * The same, but sharing the plans and tables cached in ctx.
+   */
+  stream_analyzer(
+      context & ctx,
+      double sample_rate,
+      double window_size = 0.05, // seconds
+      unsigned int padding = 0,
+      unsigned int overlap = 1,
+      transform method = transform::padded);
+
+  ~stream_analyzer();
+
+  size_t window_samples() const;
+  size_t hop_samples() const;
+  size_t fft_size() const;
+
+  /**
+   * The bytes held by its buffers and workspace. The
+   * transform and windows are counted by the context.
+   */
+  size_t bytes() const;
+
+  /**
+   * Consume up to n samples, pushing a frame onto frames
+   * every hop. When frames is full the finished frame waits
+   * for the next call and no more audio is consumed, so the
+   * return value (the number of samples consumed) can fall
+   * short of n. Once the input has ended, keep calling with
+   * n = 0 until the last frame has been pushed. The frames
+   * of the ring must have fft_size() points.
+   */
+  size_t write(
+      const double * audio,
+      size_t n,
+      frame_ring<point> & frames);
+
+ private:
+  struct state;
+  std::unique_ptr<state> s;
+};
+
+/**
+ * Synthesis of frames that arrive a hop at a time. The audio
+ * it reads is the same as synthesis() of the frames so far.
+ *
+ * read() overlap-adds one frame every hop. Given spectral
+ * frames it also inverse transforms them. Given grains that
+ * synthesize() has already transformed on another thread it
+ * only adds, which leaves the least work on the audio thread.
+ * A frame that has not arrived in time is counted as an
+ * underrun by its ring and replaced by silence.
+ *
+ * read() never allocates or locks. synthesize() may run at
+ * the same time as read(), but not as itself.
+ */
+class stream_synthesizer {
+ public:
+  stream_synthesizer(
+      size_t fft_size,
+      unsigned int padding = 0,
+      unsigned int overlap = 1,
+      transform method = transform::padded);
+
+  /**
+   * The same, but sharing the plans cached in ctx.
+   */
+  stream_synthesizer(
+      context & ctx,
+      size_t fft_size,
+      unsigned int padding = 0,
+      unsigned int overlap = 1,
+      transform method = transform::padded);
+
+  ~stream_synthesizer();
+
+  size_t window_samples() const;
+  size_t hop_samples() const;
+
+  /**
+   * The bytes held by its buffers and workspaces. The
+   * transform is counted by the context.
+   */
+  size_t bytes() const;
+
+  /**
+   * Inverse transform a frame into a grain of
+   * window_samples() samples.
+   */
+  void synthesize(
+      const std::vector<point> & frame,
+      std::vector<double> & grain);
+
+  /**
+   * Write n samples of audio, taking a frame from frames
+   * every hop. Returns the number of frames taken. Frames
+   * have the fft_size it was made with, grains
+   * window_samples() samples.
+   */
+  size_t read(
+      double * audio,
+      size_t n,
+      frame_ring<point> & frames);
+  size_t read(
+      double * audio,
+      size_t n,
+      frame_ring<double> & grains);
+
+ private:
+  struct state;
+  std::unique_ptr<state> s;
+
+  template <class Frame, class Add>
+  size_t read(double * audio, size_t n, frame_ring<Frame> & frames, Add add);
+};
+
+}
+
+/**
+ * interpolate for frames passed between threads. Runs between
+ * the analyzers of the two inputs and the synthesizer, usually
+ * on its own thread so the audio thread is left with only
+ * the overlap-add.
+ */
+class stream_interpolator {
+ public:
+  stream_interpolator(
+      size_t fft_size,
+      double window_size,
+      unsigned int overlap = 1);
+
+  /**
+   * Interpolate frames while both inputs have one and the output
+   * has room, evaluating the interpolation factor at the time of
+   * each left frame. Returns the number of frames interpolated.
+   * Every ring holds frames of the fft_size it was made with.
+   */
+  size_t process(
+      spectral::frame_ring<spectral::point> & left,
+      spectral::frame_ring<spectral::point> & right,
+      spectral::frame_ring<spectral::point> & output,
+      const curve & interpolation_factor);
+
+  /**
+   * The bytes held by its buffers.
+   */
+  size_t bytes() const;
+
+ private:
+  double window_size;
+  unsigned int overlap;
+  std::vector<double> phases;
+};
+
+}
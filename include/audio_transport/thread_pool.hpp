@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace audio_transport {
+
+/**
+ * A fixed set of worker threads that run submitted tasks.
+ *
+ * Each worker has its own deque. Tasks submitted from a worker
+ * go on the back of that worker's deque and are run newest
+ * first, so follow-up work runs while its inputs are still hot.
+ * A worker whose deque is empty steals the oldest task from
+ * another worker. Tasks submitted from other threads are dealt
+ * out to the workers in turn.
+ */
+class thread_pool {
+ public:
+  explicit thread_pool(
+      unsigned int num_threads = std::thread::hardware_concurrency());
+  ~thread_pool();
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool & operator=(const thread_pool &) = delete;
+
+  unsigned int num_threads() const { return workers.size(); }
+
+  /**
+   * Whether the calling thread is one of the workers.
+   */
+  bool is_worker() const;
+
+  /**
+   * Queue a task. Tasks may submit more tasks.
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * Block until every submitted task has finished, including
+   * the tasks they submitted. Rethrows the first exception
+   * thrown by a task since the last wait.
+   */
+  void wait();
+
+  /**
+   * The number of tasks a worker took from another worker.
+   */
+  size_t steals() const { return steals_; }
+
+ private:
+  struct queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void run(size_t index);
+  bool pop(size_t index, std::function<void()> & task);
+  bool steal(size_t index, std::function<void()> & task);
+
+  std::vector<std::unique_ptr<queue>> queues;
+  std::vector<std::thread> workers;
+
+  // Guards sleeping, waking and finishing
+  std::mutex mutex;
+  std::condition_variable work_available;
+  std::condition_variable all_done;
+  // Tasks queued but not started
+  size_t queued;
+  // Tasks queued or running
+  size_t unfinished;
+  bool stopping;
+
+  std::atomic<size_t> next_queue;
+  std::atomic<size_t> steals_;
+  std::exception_ptr error;
+};
+
+}
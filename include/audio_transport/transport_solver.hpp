@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+
+namespace audio_transport {
+
+/**
+ * Computes a transport plan between the spectral masses of two windows.
+ * Each entry of the plan (left index, right index, mass) moves that
+ * much normalized mass from a left mass to a right mass.
+ * Solvers are immutable so one can be shared across threads.
+ */
+class transport_solver {
+ public:
+  virtual ~transport_solver() {}
+
+  virtual std::vector<std::tuple<size_t, size_t, double>> solve(
+      const std::vector<spectral_mass> & left,
+      const std::vector<spectral_mass> & right,
+      const std::vector<spectral::point> & left_spectrum,
+      const std::vector<spectral::point> & right_spectrum) const = 0;
+};
+
+/**
+ * The 1D monotone (north-west corner) plan of transport_matrix.
+ * It is exact for any convex cost of frequency and runs in O(n).
+ * This is the default solver.
+ */
+class monotone_solver : public transport_solver {
+ public:
+  std::vector<std::tuple<size_t, size_t, double>> solve(
+      const std::vector<spectral_mass> & left,
+      const std::vector<spectral_mass> & right,
+      const std::vector<spectral::point> & left_spectrum,
+      const std::vector<spectral::point> & right_spectrum) const override;
+};
+
+/**
+ * Entropy regularised transport computed with log-domain
+ * Sinkhorn iterations. The cost between two masses is
+ *
+ *   (df/nyquist)^2 + time_weight * (dt/time_scale)^2
+ *
+ * where df is the distance between their reassigned center
+ * frequencies and dt is the distance between their mass weighted
+ * reassigned time offsets, so a non-zero time_weight transports
+ * over (frequency, time_reassigned) pairs.
+ *
+ * Each iteration costs O(n m). Problems larger than the budget fall
+ * back to the monotone plan.
+ */
+class sinkhorn_solver : public transport_solver {
+ public:
+  struct options {
+    options() :
+      epsilon(1e-5),
+      time_weight(0),
+      time_scale(0.05),
+      max_iterations(100),
+      tolerance(1e-6),
+      max_cost_entries(1 << 18),
+      min_mass(1e-9) {}
+
+    // Regularisation in units of the cost
+    double epsilon;
+    // Weight of the time distance relative to frequency
+    double time_weight;
+    // Time distance that costs as much as the whole band (seconds)
+    double time_scale;
+    // Budget: iterations and the size of the n by m cost matrix
+    size_t max_iterations;
+    double tolerance;
+    size_t max_cost_entries;
+    // Plan entries smaller than this are dropped
+    double min_mass;
+  };
+
+  sinkhorn_solver(options opts = options());
+
+  std::vector<std::tuple<size_t, size_t, double>> solve(
+      const std::vector<spectral_mass> & left,
+      const std::vector<spectral_mass> & right,
+      const std::vector<spectral::point> & left_spectrum,
+      const std::vector<spectral::point> & right_spectrum) const override;
+
+ private:
+  options opts;
+  monotone_solver fallback;
+};
+
+}
@@ -1,128 +1,186 @@
 #include <cmath>
 #include <vector>
+#include <algorithm>
 #include <tuple>
 #include <map>
+#include <ciso646>
+#include <cassert>
+#include <mutex>
 
 #include "audio_transport/spectral.hpp"
 #include "audio_transport/audio_transport.hpp"
+#include "audio_transport/transport_solver.hpp"
+#include "audio_transport/tonal.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/codec.hpp"
+#include "audio_transport/context.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+/**
+ * What grouping and placement read from a spectrum. Spectra
+ * stored another way (see codec.hpp) provide the same so
+ * they can be read without decoding them to points.
+ */
+class point_spectrum {
+ public:
+  point_spectrum(const std::vector<spectral::point> & points) : points(points) {}
+
+  size_t size() const { return points.size(); }
+  double magnitude(size_t i) const { return std::abs(points[i].value); }
+  double phase(size_t i) const { return std::arg(points[i].value); }
+  double freq(size_t i) const { return points[i].freq; }
+  double freq_reassigned(size_t i) const { return points[i].freq_reassigned; }
+  // How far the reassigned frequency is above the bin's
+  double freq_offset(size_t i) const { return points[i].freq_reassigned - points[i].freq; }
+
+ private:
+  const std::vector<spectral::point> & points;
+};
+
+class encoded_spectrum {
+ public:
+  encoded_spectrum(const spectral::encoded_frame & frame) :
+    frame(frame),
+    magnitudes(frame.size()),
+    phases(frame.size()),
+    freq_offsets(frame.size()) {
+    frame.decode(magnitudes.data(), phases.data(), freq_offsets.data());
+  }
 
-std::vector<audio_transport::spectral::point> audio_transport::interpolate(
-    const std::vector<audio_transport::spectral::point> & left,
-    const std::vector<audio_transport::spectral::point> & right,
-    std::vector<double> & phases,
-    double window_size,
-    double interpolation) {
+  size_t size() const { return magnitudes.size(); }
+  double magnitude(size_t i) const { return magnitudes[i]; }
+  double phase(size_t i) const { return frame.phase(phases[i]); }
+  double freq(size_t i) const { return i * frame.bin_spacing(); }
+  double freq_reassigned(size_t i) const { return freq(i) + freq_offset(i); }
+  double freq_offset(size_t i) const { return frame.freq_offset(freq_offsets[i]); }
 
-  // Group the left and right spectra
-  std::vector<spectral_mass> left_masses = group_spectrum(left);
-  std::vector<spectral_mass> right_masses = group_spectrum(right);
+ private:
+  const spectral::encoded_frame & frame;
+  std::vector<double> magnitudes;
+  std::vector<uint16_t> phases;
+  std::vector<int16_t> freq_offsets;
+};
 
-  // Get the transport matrix
-  std::vector<std::tuple<size_t, size_t, double>> T =
-    transport_matrix(left_masses, right_masses);
+template <class Spectrum>
+std::vector<spectral_mass> group(const Spectrum & spectrum) {
 
-  // Initialize the output spectral masses
-  std::vector<audio_transport::spectral::point> interpolated(left.size());
-  for (unsigned int i = 0; i < left.size(); i++) {
-    interpolated[i].freq = left[i].freq;
+  // Keep track of the total mass
+  double mass_sum = 0;
+  for (size_t i = 0; i < spectrum.size(); i++) {
+    mass_sum += spectrum.magnitude(i);
   }
 
-  // Initialize new phases
-  std::vector<double> new_amplitudes(phases.size(), 0);
-  std::vector<double> new_phases(phases.size(), 0);
+  // Initialize the first mass
+  std::vector<spectral_mass> masses;
+  audio_transport::spectral_mass initial_mass;
+  initial_mass.left_bin = 0;
+  initial_mass.center_bin = 0;
+  masses.push_back(initial_mass);
+
+  bool sign;
+  bool first = true;
+  for (size_t i = 0; i < spectrum.size(); i++) {
+    bool current_sign = (spectrum.freq_offset(i) > 0);
+
+    // Uncomment this for VERTICAL INCOHERENCE
+    //sign = false;
+    //current_sign = not sign;
 
-  // Perform the interpolation
-  for (auto t : T) {
-    spectral_mass left_mass  =  left_masses[std::get<0>(t)];
-    spectral_mass right_mass = right_masses[std::get<1>(t)];
-
-    // Calculate the new bin and frequency
-    int interpolated_bin = std::round(
-      (1 - interpolation) * left_mass.center_bin +
-      interpolation * right_mass.center_bin
-      );
-
-    // Compute the actual interpolation factor given the new bin
-    double interpolation_rounded = interpolation;
-    if (left_mass.center_bin != right_mass.center_bin) {
-      interpolation_rounded = 
-        ((double)interpolated_bin - (double)left_mass.center_bin)/
-        ((double)right_mass.center_bin - (double)left_mass.center_bin);
+    if (first) {
+      first = false;
+      sign = current_sign;
+      continue;
     }
-    // Interpolate the frequency appropriately
-    double interpolated_freq = 
-      (1 - interpolation_rounded) * left[left_mass.center_bin].freq_reassigned +
-      interpolation_rounded * right[right_mass.center_bin].freq_reassigned;
-
-    double center_phase =
-      phases[interpolated_bin] + (interpolated_freq * window_size/2.)/2. - (M_PI * interpolated_bin);
-    double new_phase = 
-      center_phase + (interpolated_freq * window_size/2.)/2. + (M_PI * interpolated_bin);
-
-    // Uncomment this for HORIZONTAL INCOHERENCE
-    // center_phase = std::arg(left[interpolated_bin].value);
-
-    // Place the left and right masses
-    place_mass(
-        left_mass, 
-        interpolated_bin, 
-        (1 - interpolation) * std::get<2>(t)/left_mass.mass,
-        interpolated_freq,
-        center_phase,
-        left,
-        interpolated,
-        new_phase,
-        new_phases,
-        new_amplitudes
-        );
-    place_mass(
-        right_mass, 
-        interpolated_bin, 
-        interpolation * std::get<2>(t)/right_mass.mass,
-        interpolated_freq,
-        center_phase,
-        right,
-        interpolated,
-        new_phase,
-        new_phases,
-        new_amplitudes
-        );
 
+    if (current_sign == sign) continue;
+
+    if (sign) {
+      // We are falling 
+      // This is the center bin
+      // Choose the one closest to the right
+
+      // These should both be positive
+      double left_dist = spectrum.freq_offset(i - 1);
+      double right_dist = -spectrum.freq_offset(i);
+
+      // Go to the closer side
+      if (left_dist < right_dist) {
+        masses[masses.size() - 1].center_bin = i - 1;
+      } else {
+        masses[masses.size() - 1].center_bin = i;
+      }
+    } else {
+      // We are rising
+      // This is the end
+
+      // Compute the actual mass
+      masses[masses.size() - 1].mass = 0;
+      for (size_t j = masses[masses.size() - 1].left_bin; j < i; j++) {
+        masses[masses.size() - 1].mass += spectrum.magnitude(j);
+      }
+
+      if (masses[masses.size() - 1].mass > 0) {
+        // Normalize
+        masses[masses.size() - 1].mass /= mass_sum;
+
+        // Set the end of the mass
+        masses[masses.size() - 1].right_bin = i;
+
+        // Construct a new mass
+        spectral_mass mass;
+        mass.left_bin = i;
+        mass.center_bin = i;
+        masses.push_back(mass);
+      }
+    }
+    sign = current_sign;
   }
 
-  // Fill the phases with the new phases
-  for (size_t i = 0; i < phases.size(); i++) {
-    phases[i] = new_phases[i];
+  // Finish the last mass
+  masses[masses.size() - 1].right_bin = spectrum.size();
+  masses[masses.size() - 1].mass = 0;
+  for (size_t j = masses[masses.size() - 1].left_bin; j < spectrum.size(); j++) {
+    masses[masses.size() - 1].mass += spectrum.magnitude(j);
   }
+  masses[masses.size() - 1].mass /= mass_sum;
 
-  return interpolated;
+  return masses;
 }
 
-void audio_transport::place_mass(
+template <class Spectrum>
+void place(
     const spectral_mass & mass,
     int center_bin,
     double scale,
     double interpolated_freq,
     double center_phase,
-    const std::vector<audio_transport::spectral::point> & input,
+    const Spectrum & input,
     std::vector<audio_transport::spectral::point> & output,
     double next_phase,
     std::vector<double> & phases,
-    std::vector<double> & amplitudes) {
+    std::vector<double> & amplitudes,
+    size_t begin,
+    size_t end) {
 
   // Compute how the phase changes in each bin
-  double phase_shift = center_phase - std::arg(input[mass.center_bin].value);
+  double phase_shift = center_phase - input.phase(mass.center_bin);
+
+  // Only the bins that land in [begin, end)
+  long shift = (long) center_bin - (long) mass.center_bin;
+  long first = std::max((long) mass.left_bin, (long) begin - shift);
+  long last = std::min((long) mass.right_bin, (long) end - shift);
 
-  for (size_t i = mass.left_bin; i < mass.right_bin; i++) {
+  for (long i = first; i < last; i++) {
     // Compute the location in the new array
-    int new_i = i + center_bin - mass.center_bin;
-    if (new_i < 0) continue;
-    if (new_i >= (int) output.size()) continue;
+    size_t new_i = i + shift;
 
     // Rotate the output by the phase offset
     // plus the frequency 
-    double phase = phase_shift + std::arg(input[i].value);
-    double mag = scale * std::abs(input[i].value);
+    double phase = phase_shift + input.phase(i);
+    double mag = scale * input.magnitude(i);
     output[new_i].value += std::polar(mag, phase);
 
     if (mag > amplitudes[new_i]) {
@@ -133,6 +191,581 @@ void audio_transport::place_mass(
   }
 }
 
+// The amplitude of each tonal mass, or zero
+std::vector<double> tonal_amplitudes(
+    const tonal_renderer & tonal,
+    const std::vector<spectral_mass> & masses,
+    const std::vector<spectral::point> & spectrum) {
+
+  double total_magnitude = 0;
+  for (size_t i = 0; i < spectrum.size(); i++) {
+    total_magnitude += std::abs(spectrum[i].value);
+  }
+
+  std::vector<double> amplitudes(masses.size(), 0);
+  for (size_t i = 0; i < masses.size(); i++) {
+    if (tonal.is_tonal(masses[i], spectrum, total_magnitude)) {
+      amplitudes[i] = tonal.amplitude(masses[i], spectrum);
+    }
+  }
+  return amplitudes;
+}
+
+/**
+ * Moves the masses of the left and right spectra
+ * to where the transport plan T puts them.
+ * Tonal masses have a non-zero amplitude.
+ */
+template <class Spectrum>
+struct placement {
+  const Spectrum & left;
+  const Spectrum & right;
+  const std::vector<spectral_mass> & left_masses;
+  const std::vector<spectral_mass> & right_masses;
+  const std::vector<std::tuple<size_t, size_t, double>> & T;
+  const tonal_renderer * tonal;
+  const std::vector<double> & left_amplitudes;
+  const std::vector<double> & right_amplitudes;
+  const std::vector<double> & phases;
+  // The time between frames
+  double hop;
+  double interpolation;
+
+  // An output with nothing placed
+  std::vector<spectral::point> empty() const {
+    std::vector<audio_transport::spectral::point> interpolated(left.size());
+    for (unsigned int i = 0; i < left.size(); i++) {
+      interpolated[i].freq = left.freq(i);
+    }
+    return interpolated;
+  }
+
+  /**
+   * Place the pairs [first, last) of T, adding only to
+   * the bins [begin, end) of the output. Tonal masses are
+   * rendered into the same range, so splitting the bins
+   * between calls gives the same output as one call.
+   */
+  void operator()(
+      size_t first,
+      size_t last,
+      size_t begin,
+      size_t end,
+      std::vector<spectral::point> & interpolated,
+      std::vector<double> & new_phases,
+      std::vector<double> & new_amplitudes) const {
+
+    // Perform the interpolation
+    for (size_t p = first; p < last; p++) {
+      const std::tuple<size_t, size_t, double> & t = T[p];
+      spectral_mass left_mass  =  left_masses[std::get<0>(t)];
+      spectral_mass right_mass = right_masses[std::get<1>(t)];
+
+      // Calculate the new bin and frequency
+      int interpolated_bin = std::round(
+        (1 - interpolation) * left_mass.center_bin +
+        interpolation * right_mass.center_bin
+        );
+
+      // Compute the actual interpolation factor given the new bin
+      double interpolation_rounded = interpolation;
+      if (left_mass.center_bin != right_mass.center_bin) {
+        interpolation_rounded = 
+          ((double)interpolated_bin - (double)left_mass.center_bin)/
+          ((double)right_mass.center_bin - (double)left_mass.center_bin);
+      }
+      // Interpolate the frequency appropriately
+      double interpolated_freq = 
+        (1 - interpolation_rounded) * left.freq_reassigned(left_mass.center_bin) +
+        interpolation_rounded * right.freq_reassigned(right_mass.center_bin);
+
+      double center_phase =
+        phases[interpolated_bin] + (interpolated_freq * hop)/2. - (M_PI * interpolated_bin);
+      double new_phase = 
+        center_phase + (interpolated_freq * hop)/2. + (M_PI * interpolated_bin);
+
+      // Uncomment this for HORIZONTAL INCOHERENCE
+      // center_phase = std::arg(left[interpolated_bin].value);
+
+      // The amplitudes of tonal masses, zero for the rest
+      double left_amplitude = tonal ? left_amplitudes[std::get<0>(t)] : 0;
+      double right_amplitude = tonal ? right_amplitudes[std::get<1>(t)] : 0;
+      double left_scale = (1 - interpolation) * std::get<2>(t)/left_mass.mass;
+      double right_scale = interpolation * std::get<2>(t)/right_mass.mass;
+
+      // Render pairs of sinusoids as one sinusoid
+      if (left_amplitude > 0 and right_amplitude > 0) {
+        tonal->render(
+            left_scale * left_amplitude + right_scale * right_amplitude,
+            interpolated_bin,
+            interpolated_freq,
+            center_phase,
+            interpolated,
+            new_phase,
+            new_phases,
+            new_amplitudes,
+            begin,
+            end
+            );
+        continue;
+      }
+
+      // Otherwise render the side that is a sinusoid,
+      // which may be paired with many small masses, and
+      // place the other
+      if (left_amplitude > 0) {
+        tonal->render(
+            left_scale * left_amplitude,
+            interpolated_bin,
+            interpolated_freq,
+            center_phase,
+            interpolated,
+            new_phase,
+            new_phases,
+            new_amplitudes,
+            begin,
+            end
+            );
+      } else {
+        place(
+            left_mass, 
+            interpolated_bin, 
+            left_scale,
+            interpolated_freq,
+            center_phase,
+            left,
+            interpolated,
+            new_phase,
+            new_phases,
+            new_amplitudes,
+            begin,
+            end
+            );
+      }
+      if (right_amplitude > 0) {
+        tonal->render(
+            right_scale * right_amplitude,
+            interpolated_bin,
+            interpolated_freq,
+            center_phase,
+            interpolated,
+            new_phase,
+            new_phases,
+            new_amplitudes,
+            begin,
+            end
+            );
+      } else {
+        place(
+            right_mass, 
+            interpolated_bin, 
+            right_scale,
+            interpolated_freq,
+            center_phase,
+            right,
+            interpolated,
+            new_phase,
+            new_phases,
+            new_amplitudes,
+            begin,
+            end
+            );
+      }
+    }
+  }
+};
+
+template <class Spectrum>
+std::vector<spectral::point> place_masses(
+    const Spectrum & left,
+    const Spectrum & right,
+    const std::vector<spectral_mass> & left_masses,
+    const std::vector<spectral_mass> & right_masses,
+    const std::vector<std::tuple<size_t, size_t, double>> & T,
+    const tonal_renderer * tonal,
+    const std::vector<double> & left_amplitudes,
+    const std::vector<double> & right_amplitudes,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    unsigned int overlap) {
+
+  placement<Spectrum> place_pairs = {
+    left, right,
+    left_masses, right_masses,
+    T,
+    tonal, left_amplitudes, right_amplitudes,
+    phases,
+    window_size/(2 * overlap),
+    interpolation};
+
+  // Initialize the output spectral masses and new phases
+  std::vector<audio_transport::spectral::point> interpolated = place_pairs.empty();
+  std::vector<double> new_amplitudes(phases.size(), 0);
+  std::vector<double> new_phases(phases.size(), 0);
+
+  place_pairs(0, T.size(), 0, interpolated.size(), interpolated, new_phases, new_amplitudes);
+
+  // Fill the phases with the new phases
+  for (size_t i = 0; i < phases.size(); i++) {
+    phases[i] = new_phases[i];
+  }
+
+  return interpolated;
+}
+
+std::vector<spectral::point> interpolate_with(
+    const std::vector<spectral::point> & left,
+    const std::vector<spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    const transport_solver & solver,
+    const tonal_renderer * tonal,
+    unsigned int overlap) {
+
+  // Group the left and right spectra
+  std::vector<spectral_mass> left_masses = group_spectrum(left);
+  std::vector<spectral_mass> right_masses = group_spectrum(right);
+
+  // Get the transport matrix
+  std::vector<std::tuple<size_t, size_t, double>> T =
+    solver.solve(left_masses, right_masses, left, right);
+
+  // Find the masses that are single sinusoids
+  std::vector<double> left_amplitudes, right_amplitudes;
+  if (tonal) {
+    left_amplitudes  = tonal_amplitudes(*tonal, left_masses, left);
+    right_amplitudes = tonal_amplitudes(*tonal, right_masses, right);
+  }
+
+  return place_masses(
+      point_spectrum(left),
+      point_spectrum(right),
+      left_masses,
+      right_masses,
+      T,
+      tonal,
+      left_amplitudes,
+      right_amplitudes,
+      phases,
+      window_size,
+      interpolation,
+      overlap);
+}
+
+std::vector<spectral::point> interpolate_on(
+    context & ctx,
+    const std::vector<spectral::point> & left,
+    const std::vector<spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    const transport_solver & solver,
+    const tonal_renderer * tonal,
+    unsigned int overlap) {
+
+  // Group the left and right spectra at once,
+  // finding the masses that are single sinusoids
+  std::vector<spectral_mass> masses[2];
+  std::vector<double> amplitudes[2];
+  ctx.parallel_for(2, [&](size_t begin, size_t end) {
+    for (size_t s = begin; s < end; s++) {
+      const std::vector<spectral::point> & spectrum = s == 0 ? left : right;
+      masses[s] = group_spectrum(spectrum);
+      if (tonal) amplitudes[s] = tonal_amplitudes(*tonal, masses[s], spectrum);
+    }
+  });
+
+  // Get the transport matrix
+  std::vector<std::tuple<size_t, size_t, double>> T =
+    solver.solve(masses[0], masses[1], left, right);
+
+  point_spectrum left_spectrum(left);
+  point_spectrum right_spectrum(right);
+  placement<point_spectrum> place_pairs = {
+    left_spectrum, right_spectrum,
+    masses[0], masses[1],
+    T,
+    tonal, amplitudes[0], amplitudes[1],
+    phases,
+    window_size/(2 * overlap),
+    interpolation};
+
+  std::vector<audio_transport::spectral::point> interpolated = place_pairs.empty();
+  std::vector<double> new_amplitudes(phases.size(), 0);
+  std::vector<double> new_phases(phases.size(), 0);
+
+  if (ctx.deterministic()) {
+    // Each thread owns a range of output bins and places every
+    // pair into it in plan order, as a single thread would
+    ctx.parallel_for(interpolated.size(), [&](size_t begin, size_t end) {
+      place_pairs(0, T.size(), begin, end, interpolated, new_phases, new_amplitudes);
+    });
+  } else {
+    // Each thread places a range of pairs into its own
+    // output, which is merged as it finishes
+    std::mutex mutex;
+    ctx.parallel_for(T.size(), [&](size_t first, size_t last) {
+      std::vector<spectral::point> part = place_pairs.empty();
+      std::vector<double> part_amplitudes(phases.size(), 0);
+      std::vector<double> part_phases(phases.size(), 0);
+      place_pairs(first, last, 0, part.size(), part, part_phases, part_amplitudes);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t i = 0; i < part.size(); i++) {
+        interpolated[i].value += part[i].value;
+        if (part_amplitudes[i] > new_amplitudes[i]) {
+          new_amplitudes[i] = part_amplitudes[i];
+          new_phases[i] = part_phases[i];
+          interpolated[i].freq_reassigned = part[i].freq_reassigned;
+        }
+      }
+    });
+  }
+
+  // Fill the phases with the new phases
+  for (size_t i = 0; i < phases.size(); i++) {
+    phases[i] = new_phases[i];
+  }
+
+  return interpolated;
+}
+
+std::vector<std::vector<spectral::point>> interpolate_frames_on(
+    context & ctx,
+    const std::vector<std::vector<spectral::point>> & left,
+    const std::vector<std::vector<spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    const transport_solver & solver,
+    const tonal_renderer * tonal,
+    unsigned int overlap) {
+
+  size_t num_windows = std::min(left.size(), right.size());
+  std::vector<std::vector<spectral::point>> interpolated(num_windows);
+  if (num_windows == 0) return interpolated;
+
+  // Frames run in order, each carrying its phases over to the next
+  std::vector<double> phases(left[0].size(), 0);
+  for (size_t w = 0; w < num_windows; w++) {
+    double interpolation = interpolation_factor(left[w][0].time);
+    interpolation = std::min(1., std::max(0., interpolation));
+
+    interpolated[w] = interpolate_on(
+        ctx, left[w], right[w], phases, window_size, interpolation, solver, tonal, overlap);
+  }
+
+  return interpolated;
+}
+
+}
+
+std::vector<audio_transport::spectral::point> audio_transport::interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    unsigned int overlap) {
+  return interpolate_with(left, right, phases, window_size, interpolation, monotone_solver(), nullptr, overlap);
+}
+
+std::vector<audio_transport::spectral::point> audio_transport::interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    const transport_solver & solver,
+    unsigned int overlap) {
+  return interpolate_with(left, right, phases, window_size, interpolation, solver, nullptr, overlap);
+}
+
+std::vector<audio_transport::spectral::point> audio_transport::interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    const transport_solver & solver,
+    const tonal_renderer & tonal,
+    unsigned int overlap) {
+  return interpolate_with(left, right, phases, window_size, interpolation, solver, &tonal, overlap);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::interpolate(
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap) {
+
+  size_t num_windows = std::min(left.size(), right.size());
+  std::vector<std::vector<audio_transport::spectral::point>> interpolated(num_windows);
+  if (num_windows == 0) return interpolated;
+
+  std::vector<double> phases(left[0].size(), 0);
+  for (size_t w = 0; w < num_windows; w++) {
+    double interpolation = interpolation_factor(left[w][0].time);
+    interpolation = std::min(1., std::max(0., interpolation));
+
+    interpolated[w] = interpolate(left[w], right[w], phases, window_size, interpolation, overlap);
+  }
+
+  return interpolated;
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap) {
+  return interpolate(ctx, left, right, window_size, interpolation_factor, monotone_solver(), overlap);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    const transport_solver & solver,
+    unsigned int overlap) {
+  return interpolate_frames_on(ctx, left, right, window_size, interpolation_factor, solver, nullptr, overlap);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::interpolate(
+    context & ctx,
+    const std::vector<std::vector<audio_transport::spectral::point>> & left,
+    const std::vector<std::vector<audio_transport::spectral::point>> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    const transport_solver & solver,
+    const tonal_renderer & tonal,
+    unsigned int overlap) {
+  return interpolate_frames_on(ctx, left, right, window_size, interpolation_factor, solver, &tonal, overlap);
+}
+
+std::vector<audio_transport::spectral::point> audio_transport::interpolate(
+    const spectral::encoded_frame & left,
+    const spectral::encoded_frame & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    unsigned int overlap) {
+
+  // Decode the magnitudes once, the rest as they are read
+  encoded_spectrum left_spectrum(left);
+  encoded_spectrum right_spectrum(right);
+
+  std::vector<spectral_mass> left_masses = group(left_spectrum);
+  std::vector<spectral_mass> right_masses = group(right_spectrum);
+
+  std::vector<std::tuple<size_t, size_t, double>> T =
+    transport_matrix(left_masses, right_masses);
+
+  return place_masses(
+      left_spectrum,
+      right_spectrum,
+      left_masses,
+      right_masses,
+      T,
+      nullptr,
+      std::vector<double>(),
+      std::vector<double>(),
+      phases,
+      window_size,
+      interpolation,
+      overlap);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::interpolate(
+    const std::vector<spectral::encoded_frame> & left,
+    const std::vector<spectral::encoded_frame> & right,
+    double window_size,
+    const curve & interpolation_factor,
+    unsigned int overlap) {
+
+  size_t num_windows = std::min(left.size(), right.size());
+  std::vector<std::vector<audio_transport::spectral::point>> interpolated(num_windows);
+  if (num_windows == 0) return interpolated;
+
+  std::vector<double> phases(left[0].size(), 0);
+  for (size_t w = 0; w < num_windows; w++) {
+    double interpolation = interpolation_factor(left[w].time());
+    interpolation = std::min(1., std::max(0., interpolation));
+
+    interpolated[w] = interpolate(left[w], right[w], phases, window_size, interpolation, overlap);
+  }
+
+  return interpolated;
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::glide(
+    const std::vector<std::vector<audio_transport::spectral::point>> & points,
+    double window_size,
+    const curve & time_constant,
+    unsigned int overlap,
+    glide_response response) {
+
+  std::vector<std::vector<audio_transport::spectral::point>> interpolated(points.size());
+  if (points.empty()) return interpolated;
+
+  double hop = window_size/(2 * overlap);
+  std::vector<double> phases(points[0].size(), 0);
+  for (size_t w = 0; w < points.size(); w++) {
+    double tau = time_constant(points[w][0].time);
+    double interpolation;
+    if (response == glide_response::exponential) {
+      interpolation = (tau > 0) ? 1 - std::exp(-hop/tau) : 1;
+    } else {
+      interpolation = std::exp(-tau/window_size);
+      if (overlap > 1) {
+        // Keep overlap hops' worth of the previous frame
+        // as much as one hop of half a window would
+        interpolation = 1 - std::pow(1 - interpolation, 1./overlap);
+      }
+    }
+
+    // Feed the previous output back in without copying it
+    const std::vector<audio_transport::spectral::point> & prev =
+      (w == 0) ? points[0] : interpolated[w - 1];
+
+    interpolated[w] = interpolate(prev, points[w], phases, window_size, interpolation, overlap);
+  }
+
+  return interpolated;
+}
+
+void audio_transport::place_mass(
+    const spectral_mass & mass,
+    int center_bin,
+    double scale,
+    double interpolated_freq,
+    double center_phase,
+    const std::vector<audio_transport::spectral::point> & input,
+    std::vector<audio_transport::spectral::point> & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes) {
+  place(
+      mass,
+      center_bin,
+      scale,
+      interpolated_freq,
+      center_phase,
+      point_spectrum(input),
+      output,
+      next_phase,
+      phases,
+      amplitudes,
+      0,
+      output.size());
+}
+
 std::vector<std::tuple<size_t, size_t, double>> audio_transport::transport_matrix(
     const std::vector<audio_transport::spectral_mass> & left,
     const std::vector<audio_transport::spectral_mass> & right) {
@@ -175,86 +808,5 @@ std::vector<std::tuple<size_t, size_t, double>> audio_transport::transport_matri
 std::vector<audio_transport::spectral_mass> audio_transport::group_spectrum(
    const std::vector<audio_transport::spectral::point> & spectrum
    ) {
-
-  // Keep track of the total mass
-  double mass_sum = 0;
-  for (size_t i = 0; i < spectrum.size(); i++) {
-    mass_sum += std::abs(spectrum[i].value);
-  }
-
-  // Initialize the first mass
-  std::vector<spectral_mass> masses;
-  audio_transport::spectral_mass initial_mass;
-  initial_mass.left_bin = 0;
-  initial_mass.center_bin = 0;
-  masses.push_back(initial_mass);
-
-  bool sign;
-  bool first = true;
-  for (size_t i = 0; i < spectrum.size(); i++) {
-    bool current_sign = (spectrum[i].freq_reassigned > spectrum[i].freq);
-
-    // Uncomment this for VERTICAL INCOHERENCE
-    //sign = false;
-    //current_sign = not sign;
-
-    if (first) {
-      first = false;
-      sign = current_sign;
-      continue;
-    }
-
-    if (current_sign == sign) continue;
-
-    if (sign) {
-      // We are falling 
-      // This is the center bin
-      // Choose the one closest to the right
-
-      // These should both be positive
-      double left_dist = spectrum[i - 1].freq_reassigned - spectrum[i - 1].freq;
-      double right_dist = spectrum[i].freq - spectrum[i].freq_reassigned;
-
-      // Go to the closer side
-      if (left_dist < right_dist) {
-        masses[masses.size() - 1].center_bin = i - 1;
-      } else {
-        masses[masses.size() - 1].center_bin = i;
-      }
-    } else {
-      // We are rising
-      // This is the end
-
-      // Compute the actual mass
-      masses[masses.size() - 1].mass = 0;
-      for (size_t j = masses[masses.size() - 1].left_bin; j < i; j++) {
-        masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
-      }
-
-      if (masses[masses.size() - 1].mass > 0) {
-        // Normalize
-        masses[masses.size() - 1].mass /= mass_sum;
-
-        // Set the end of the mass
-        masses[masses.size() - 1].right_bin = i;
-
-        // Construct a new mass
-        spectral_mass mass;
-        mass.left_bin = i;
-        mass.center_bin = i;
-        masses.push_back(mass);
-      }
-    }
-    sign = current_sign;
-  }
-
-  // Finish the last mass
-  masses[masses.size() - 1].right_bin = spectrum.size();
-  masses[masses.size() - 1].mass = 0;
-  for (size_t j = masses[masses.size() - 1].left_bin; j < spectrum.size(); j++) {
-    masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
-  }
-  masses[masses.size() - 1].mass /= mass_sum;
-
-  return masses;
-} 
+  return group(point_spectrum(spectrum));
+}
@@ -0,0 +1,106 @@
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/automation.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+typedef std::pair<double, double> control_point;
+
+bool earlier(const control_point & a, const control_point & b) {
+  return a.first < b.first;
+}
+
+double cubic(double a, double b, double c, double d, double s) {
+  double r = 1 - s;
+  return r * r * r * a + 3 * r * r * s * b + 3 * r * s * s * c + s * s * s * d;
+}
+
+}
+
+audio_transport::breakpoint_curve::breakpoint_curve(
+    std::vector<std::pair<double, double>> breakpoints) :
+  breakpoints(std::move(breakpoints)) {
+  assert(not this->breakpoints.empty());
+  std::stable_sort(this->breakpoints.begin(), this->breakpoints.end(), earlier);
+}
+
+double audio_transport::breakpoint_curve::operator()(double time) const {
+  // The first breakpoint after time
+  auto next = std::upper_bound(
+      breakpoints.begin(), breakpoints.end(),
+      control_point(time, 0), earlier);
+  if (next == breakpoints.begin()) return next->second;
+  if (next == breakpoints.end()) return breakpoints.back().second;
+
+  auto prev = next - 1;
+  double t = (time - prev->first)/(next->first - prev->first);
+  return (1 - t) * prev->second + t * next->second;
+}
+
+audio_transport::bezier_curve::bezier_curve(
+    std::vector<std::pair<double, double>> control_points) :
+  points(std::move(control_points)) {
+  assert(points.size() % 3 == 1);
+}
+
+double audio_transport::bezier_curve::operator()(double time) const {
+  size_t num_segments = points.size()/3;
+  if (num_segments == 0 or time <= points.front().first) return points.front().second;
+  if (time >= points.back().first) return points.back().second;
+
+  // Find the segment whose ends surround time
+  size_t lo = 0, hi = num_segments;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi)/2;
+    if (points[3 * mid].first <= time) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  const control_point * p = points.data() + 3 * lo;
+
+  // The segment's time increases with s, so
+  // bisect for the s that lands on time
+  double s_lo = 0, s_hi = 1;
+  for (int i = 0; i < 40; i++) {
+    double s = (s_lo + s_hi)/2;
+    if (cubic(p[0].first, p[1].first, p[2].first, p[3].first, s) < time) {
+      s_lo = s;
+    } else {
+      s_hi = s;
+    }
+  }
+
+  return cubic(p[0].second, p[1].second, p[2].second, p[3].second, (s_lo + s_hi)/2);
+}
+
+audio_transport::stream_curve::stream_curve(
+    const double * samples,
+    size_t num_samples,
+    double sample_rate,
+    double start_time) :
+  samples(samples),
+  num_samples(num_samples),
+  sample_rate(sample_rate),
+  start_time(start_time) {
+  assert(num_samples > 0);
+  assert(sample_rate > 0);
+}
+
+double audio_transport::stream_curve::operator()(double time) const {
+  double index = (time - start_time) * sample_rate;
+  if (not (index > 0)) return samples[0];
+  if (index >= num_samples - 1) return samples[num_samples - 1];
+
+  size_t i = index;
+  double fraction = index - i;
+  return (1 - fraction) * samples[i] + fraction * samples[i + 1];
+}
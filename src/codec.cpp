@@ -0,0 +1,259 @@
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/codec.hpp"
+
+using namespace audio_transport;
+using spectral::point;
+
+namespace {
+
+// The log magnitude code of a zero
+const uint16_t silent = 65535;
+
+// Steps per octave of log magnitudes
+const double log_steps = 512;
+
+// From the exponent bias of a half to a float's
+const float half_rescale = std::ldexp(1.f, 112);
+
+uint16_t to_half(double x) {
+  // x is in [0, 1]. Halves below 2^-14 are subnormal,
+  // counting in steps of 2^-24. A nonzero x is never
+  // rounded to zero: a mass of zero cannot be scaled.
+  int e;
+  double m = std::frexp(x, &e);
+  int exponent = e + 14;
+  if (x == 0) return 0;
+  if (exponent <= 0) {
+    return std::max(1l, std::lround(std::ldexp(x, 24)));
+  }
+  // A mantissa that rounds up to 1024 carries into the exponent
+  return (exponent << 10) + std::lround((2 * m - 1) * 1024);
+}
+
+float from_half(uint16_t h) {
+  // Move the exponent and mantissa into a float and rescale
+  // the exponent, which handles subnormals without a branch
+  uint32_t bits = uint32_t(h & 0x7fff) << 13;
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f * half_rescale;
+}
+
+// Round to the nearest step, but never a nonzero
+// offset to zero, and clamp to the range of the code
+int16_t to_fixed(double offset, double step) {
+  if (not (offset != 0)) return 0;
+  double code = std::round(offset/step);
+  if (code == 0) code = offset > 0 ? 1 : -1;
+  return std::max(-32767., std::min(32767., code));
+}
+
+void write_varint(size_t n, std::vector<uint8_t> & bytes) {
+  while (n >= 128) {
+    bytes.push_back((n & 127) | 128);
+    n >>= 7;
+  }
+  bytes.push_back(n);
+}
+
+size_t read_varint(const uint8_t * & bytes) {
+  size_t n = 0;
+  for (unsigned int shift = 0; ; shift += 7) {
+    n |= size_t(*bytes & 127) << shift;
+    if (not (*bytes++ & 128)) return n;
+  }
+}
+
+}
+
+const double audio_transport::spectral::encoded_frame::phase_step = 2 * M_PI/65536;
+
+audio_transport::spectral::encoded_frame::encoded_frame() :
+  num_bins_(0),
+  time_(0),
+  bin_spacing_(0),
+  peak_(0),
+  freq_step_(0),
+  time_step_(0),
+  format_(spectral::magnitude_format::log) {}
+
+audio_transport::spectral::encoded_frame::encoded_frame(
+    const std::vector<point> & frame,
+    const spectral::codec_options & options) :
+  num_bins_(frame.size()),
+  time_(frame.empty() ? 0 : frame[0].time),
+  bin_spacing_(frame.size() < 2 ? 0 : frame[1].freq - frame[0].freq),
+  peak_(0),
+  freq_step_(options.freq_resolution * bin_spacing_),
+  time_step_(options.time_resolution),
+  format_(options.magnitudes) {
+
+  assert(options.freq_resolution > 0);
+  assert(options.time_resolution > 0);
+
+  for (const point & p : frame) {
+    peak_ = std::max(peak_, std::abs(p.value));
+  }
+
+  // Choose the bins to keep, storing the lengths of
+  // alternating runs of dropped and kept bins
+  double floor = options.floor * peak_;
+  size_t dropped = 0, kept = 0;
+  for (size_t i = 0; i < frame.size(); i++) {
+    double magnitude = std::abs(frame[i].value);
+    if (options.floor > 0) {
+      if (not (magnitude > floor)) {
+        if (kept > 0) {
+          write_varint(dropped, indices_);
+          write_varint(kept, indices_);
+          dropped = kept = 0;
+        }
+        dropped++;
+        continue;
+      }
+      kept++;
+    }
+
+    if (peak_ == 0) {
+      magnitudes_.push_back(format_ == spectral::magnitude_format::log ? silent : 0);
+    } else if (format_ == spectral::magnitude_format::half) {
+      magnitudes_.push_back(to_half(magnitude/peak_));
+    } else if (magnitude == 0) {
+      magnitudes_.push_back(silent);
+    } else {
+      double code = std::round(-std::log2(magnitude/peak_) * log_steps);
+      magnitudes_.push_back(std::min(code, silent - 1.));
+    }
+
+    phases_.push_back(int32_t(std::lround(std::arg(frame[i].value)/phase_step)));
+    freq_offsets_.push_back(to_fixed(frame[i].freq_reassigned - frame[i].freq, freq_step_));
+    time_offsets_.push_back(to_fixed(frame[i].time_reassigned - frame[i].time, time_step_));
+  }
+
+  if (kept > 0) {
+    write_varint(dropped, indices_);
+    write_varint(kept, indices_);
+  }
+
+  // Leave no room for more bins
+  magnitudes_.shrink_to_fit();
+  phases_.shrink_to_fit();
+  freq_offsets_.shrink_to_fit();
+  time_offsets_.shrink_to_fit();
+  indices_.shrink_to_fit();
+}
+
+template <class Bin>
+void audio_transport::spectral::encoded_frame::for_each_bin(Bin bin) const {
+  if (indices_.empty() and magnitudes_.size() == num_bins_) {
+    for (size_t k = 0; k < num_bins_; k++) bin(k, k);
+    return;
+  }
+
+  const uint8_t * index = indices_.data();
+  size_t i = 0, k = 0;
+  while (k < magnitudes_.size()) {
+    i += read_varint(index);
+    for (size_t end = k + read_varint(index); k < end; k++, i++) {
+      bin(i, k);
+    }
+  }
+}
+
+void audio_transport::spectral::encoded_frame::decode(
+    double * magnitudes,
+    uint16_t * phases,
+    int16_t * freq_offsets) const {
+
+  if (magnitudes_.size() == num_bins_) {
+    // Straight loops over the arrays
+    const uint16_t * m = magnitudes_.data();
+    if (format_ == spectral::magnitude_format::half) {
+      for (size_t i = 0; i < num_bins_; i++) {
+        magnitudes[i] = peak_ * from_half(m[i]);
+      }
+    } else {
+      for (size_t i = 0; i < num_bins_; i++) {
+        magnitudes[i] = m[i] == silent ? 0 : peak_ * std::exp2(-m[i]/log_steps);
+      }
+    }
+    std::copy(phases_.begin(), phases_.end(), phases);
+    std::copy(freq_offsets_.begin(), freq_offsets_.end(), freq_offsets);
+    return;
+  }
+
+  // Scatter the kept bins
+  std::fill(magnitudes, magnitudes + num_bins_, 0);
+  std::fill(phases, phases + num_bins_, 0);
+  std::fill(freq_offsets, freq_offsets + num_bins_, 0);
+  for_each_bin([&](size_t i, size_t k) {
+      uint16_t m = magnitudes_[k];
+      if (format_ == spectral::magnitude_format::half) {
+        magnitudes[i] = peak_ * from_half(m);
+      } else {
+        magnitudes[i] = m == silent ? 0 : peak_ * std::exp2(-m/log_steps);
+      }
+      phases[i] = phases_[k];
+      freq_offsets[i] = freq_offsets_[k];
+    });
+}
+
+std::vector<point> audio_transport::spectral::encoded_frame::decode() const {
+  std::vector<double> magnitudes(num_bins_);
+  std::vector<uint16_t> phases(num_bins_);
+  std::vector<int16_t> freq_offsets(num_bins_);
+  decode(magnitudes.data(), phases.data(), freq_offsets.data());
+
+  std::vector<int16_t> time_offsets(num_bins_, 0);
+  for_each_bin([&](size_t i, size_t k) {
+      time_offsets[i] = time_offsets_[k];
+    });
+
+  std::vector<point> frame(num_bins_);
+  for (size_t i = 0; i < num_bins_; i++) {
+    frame[i].value = std::polar(magnitudes[i], phase(phases[i]));
+    frame[i].time = time_;
+    frame[i].freq = i * bin_spacing_;
+    frame[i].time_reassigned = time_ + time_offsets[i] * time_step_;
+    frame[i].freq_reassigned = frame[i].freq + freq_offset(freq_offsets[i]);
+  }
+  return frame;
+}
+
+size_t audio_transport::spectral::encoded_frame::bytes() const {
+  return
+    sizeof(spectral::encoded_frame) +
+    magnitudes_.capacity() * sizeof(uint16_t) +
+    phases_.capacity() * sizeof(uint16_t) +
+    freq_offsets_.capacity() * sizeof(int16_t) +
+    time_offsets_.capacity() * sizeof(int16_t) +
+    indices_.capacity() * sizeof(uint8_t);
+}
+
+std::vector<spectral::encoded_frame> audio_transport::spectral::encode(
+    const std::vector<std::vector<point>> & points,
+    const spectral::codec_options & options) {
+  std::vector<spectral::encoded_frame> frames;
+  frames.reserve(points.size());
+  for (const std::vector<point> & frame : points) {
+    frames.emplace_back(frame, options);
+  }
+  return frames;
+}
+
+std::vector<std::vector<point>> audio_transport::spectral::decode(
+    const std::vector<spectral::encoded_frame> & frames) {
+  std::vector<std::vector<point>> points;
+  points.reserve(frames.size());
+  for (const spectral::encoded_frame & frame : frames) {
+    points.push_back(frame.decode());
+  }
+  return points;
+}
@@ -0,0 +1,161 @@
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+#include <ciso646>
+
+#include "audio_transport/context.hpp"
+#include "audio_transport/fft.hpp"
+#include "audio_transport/thread_pool.hpp"
+
+audio_transport::context::context(unsigned int num_threads) :
+  num_threads_(std::max(1u, num_threads)),
+  deterministic_(true),
+  bytes_(0) {
+  // The cached plans lock the planner mutex when they are
+  // destroyed. Constructing it first makes it outlive any
+  // context with static storage, such as default_context().
+  spectral::fftw_planner_mutex();
+}
+
+audio_transport::context::~context() {}
+
+void audio_transport::context::set_num_threads(unsigned int num_threads) {
+  num_threads_ = std::max(1u, num_threads);
+}
+
+void audio_transport::context::set_deterministic(bool deterministic) {
+  deterministic_ = deterministic;
+}
+
+void audio_transport::context::clear() {
+  // Destroy outside of the lock
+  std::map<key, std::pair<std::shared_ptr<const void>, size_t>> old_resources;
+  std::map<key, std::vector<std::pair<std::shared_ptr<void>, size_t>>> old_idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    old_resources.swap(resources);
+    old_idle.swap(idle);
+    for (const auto & resource : old_resources) {
+      bytes_ -= resource.second.second;
+    }
+    for (const auto & items : old_idle) {
+      for (const auto & item : items.second) bytes_ -= item.second;
+    }
+  }
+}
+
+std::shared_ptr<const void> audio_transport::context::find(
+    std::type_index type,
+    const signature & s) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = resources.find(key(type, s));
+  if (it == resources.end()) return nullptr;
+  return it->second.first;
+}
+
+std::shared_ptr<const void> audio_transport::context::insert(
+    std::type_index type,
+    const signature & s,
+    std::shared_ptr<const void> item,
+    size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Keeps the existing object if a racing thread inserted first
+  auto inserted = resources.emplace(key(type, s), std::make_pair(std::move(item), bytes));
+  if (inserted.second) bytes_ += bytes;
+  return inserted.first->second.first;
+}
+
+std::shared_ptr<void> audio_transport::context::take(
+    std::type_index type,
+    const signature & s) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = idle.find(key(type, s));
+  if (it == idle.end() or it->second.empty()) return nullptr;
+  std::shared_ptr<void> item = std::move(it->second.back().first);
+  it->second.pop_back();
+  return item;
+}
+
+void audio_transport::context::release(
+    std::type_index type,
+    const signature & s,
+    std::shared_ptr<void> item,
+    size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  idle[key(type, s)].emplace_back(std::move(item), bytes);
+}
+
+std::shared_ptr<audio_transport::thread_pool> audio_transport::context::workers(
+    unsigned int num_threads) const {
+  std::lock_guard<std::mutex> lock(workers_mutex);
+  if (not workers_ or workers_->num_threads() != num_threads - 1) {
+    workers_ = std::make_shared<thread_pool>(num_threads - 1);
+  }
+  return workers_;
+}
+
+void audio_transport::context::parallel_for(
+    size_t n,
+    const std::function<void(size_t, size_t)> & f) const {
+
+  size_t num_threads = std::min<size_t>(num_threads_, n);
+  std::shared_ptr<thread_pool> pool;
+  if (num_threads > 1) {
+    pool = workers(num_threads_);
+    // A worker waiting on the others could leave no one to run them
+    if (pool->is_worker()) num_threads = 1;
+  }
+  if (num_threads <= 1) {
+    if (n > 0) f(0, n);
+    return;
+  }
+
+  // Counts down the ranges of this call, which may
+  // share the workers with calls on other threads
+  struct {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+    std::exception_ptr error;
+  } call;
+  call.remaining = num_threads - 1;
+
+  // Split into contiguous ranges and
+  // run the first one on this thread
+  for (size_t t = 1; t < num_threads; t++) {
+    size_t begin = (t * n)/num_threads;
+    size_t end = ((t + 1) * n)/num_threads;
+    pool->submit([&call, &f, begin, end] {
+      std::exception_ptr error;
+      try {
+        f(begin, end);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(call.mutex);
+      if (error and not call.error) call.error = error;
+      if (--call.remaining == 0) call.done.notify_all();
+    });
+  }
+
+  std::exception_ptr error;
+  try {
+    f(0, n/num_threads);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> lock(call.mutex);
+  call.done.wait(lock, [&call] { return call.remaining == 0; });
+  if (not error) error = call.error;
+  if (error) std::rethrow_exception(error);
+}
+
+audio_transport::context & audio_transport::default_context() {
+  static context ctx;
+  return ctx;
+}
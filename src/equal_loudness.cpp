@@ -23,20 +23,30 @@ double audio_transport::equal_loudness::a_weighting_amp(double freq) {
 void audio_transport::equal_loudness::apply(
     std::vector<std::vector<spectral::point>> & points) {
   for (size_t w = 0; w < points.size(); w++) {
-    for (size_t i = 0; i < points[w].size(); i++) {
-      points[w][i].value *= equal_loudness::a_weighting_amp(points[w][i].freq);
-    }
+    equal_loudness::apply(points[w]);
   }
 }
 
 void audio_transport::equal_loudness::remove(
     std::vector<std::vector<spectral::point>> & points) {
   for (size_t w = 0; w < points.size(); w++) {
-    for (size_t i = 0; i < points[w].size(); i++) {
-      double value = equal_loudness::a_weighting_amp(points[w][i].freq);
-      if (value > 0) {
-        points[w][i].value /= value;
-      }
+    equal_loudness::remove(points[w]);
+  }
+}
+
+void audio_transport::equal_loudness::apply(
+    std::vector<spectral::point> & frame) {
+  for (size_t i = 0; i < frame.size(); i++) {
+    frame[i].value *= equal_loudness::a_weighting_amp(frame[i].freq);
+  }
+}
+
+void audio_transport::equal_loudness::remove(
+    std::vector<spectral::point> & frame) {
+  for (size_t i = 0; i < frame.size(); i++) {
+    double value = equal_loudness::a_weighting_amp(frame[i].freq);
+    if (value > 0) {
+      frame[i].value /= value;
     }
   }
 }
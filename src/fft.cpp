@@ -0,0 +1,126 @@
+#include <mutex>
+#include <complex>
+#include <algorithm>
+
+#include <fftw3.h>
+
+#include "audio_transport/fft.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+fftw_complex * as_fftw(std::complex<double> * x) {
+  return reinterpret_cast<fftw_complex *>(x);
+}
+
+template <class T>
+T * allocate(size_t n) {
+  return (T *) fftw_malloc(sizeof(T) * n);
+}
+
+}
+
+std::mutex & audio_transport::spectral::fftw_planner_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+struct audio_transport::spectral::padded_fft::plans {
+  fftw_plan forward;
+  fftw_plan inverse;
+};
+
+void audio_transport::spectral::padded_fft::workspace::deleter::operator()(
+    void * p) const {
+  fftw_free(p);
+}
+
+audio_transport::spectral::padded_fft::workspace::workspace(
+    const padded_fft & transform) :
+  bytes_(
+      4 * transform.N_padded * sizeof(double) +
+      3 * transform.fft_size() * sizeof(std::complex<double>)),
+  window  (allocate<double>(transform.N_padded)),
+  window_t(allocate<double>(transform.N_padded)),
+  window_d(allocate<double>(transform.N_padded)),
+  fft  (allocate<std::complex<double>>(transform.fft_size())),
+  fft_t(allocate<std::complex<double>>(transform.fft_size())),
+  fft_d(allocate<std::complex<double>>(transform.fft_size())),
+  output(allocate<double>(transform.N_padded)) {
+  std::fill(window  .get(), window  .get() + transform.N_padded, 0);
+  std::fill(window_t.get(), window_t.get() + transform.N_padded, 0);
+  std::fill(window_d.get(), window_d.get() + transform.N_padded, 0);
+}
+
+audio_transport::spectral::padded_fft::padded_fft(
+    size_t window_samples,
+    unsigned int padding) :
+  N(window_samples),
+  padding_(padding),
+  N_padded(N * (1 + padding)),
+  padding_samples((N_padded - N)/2),
+  plans_(new plans) {
+
+  // Plan on scratch buffers aligned like the workspaces
+  std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+  double * window    = allocate<double>(N_padded);
+  fftw_complex * fft = allocate<fftw_complex>(fft_size());
+  plans_->forward = fftw_plan_dft_r2c_1d(N_padded, window, fft, FFTW_MEASURE);
+  plans_->inverse = fftw_plan_dft_c2r_1d(N_padded, fft, window, FFTW_MEASURE);
+  fftw_free(window);
+  fftw_free(fft);
+}
+
+audio_transport::spectral::padded_fft::~padded_fft() {
+  std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+  fftw_destroy_plan(plans_->forward);
+  fftw_destroy_plan(plans_->inverse);
+}
+
+size_t audio_transport::spectral::padded_fft::bytes() const {
+  return
+    sizeof(*this) + sizeof(plans) +
+    N_padded * sizeof(double) +
+    fft_size() * sizeof(std::complex<double>);
+}
+
+void audio_transport::spectral::padded_fft::forward(
+    const double * x,
+    const double * x_t,
+    const double * x_d,
+    std::complex<double> * X,
+    std::complex<double> * X_t,
+    std::complex<double> * X_d,
+    workspace & w) const {
+
+  // Fill the center of the padded frames
+  std::copy(x,   x   + N, w.window  .get() + padding_samples);
+  std::copy(x_t, x_t + N, w.window_t.get() + padding_samples);
+  std::copy(x_d, x_d + N, w.window_d.get() + padding_samples);
+
+  // Execute the plans
+  fftw_execute_dft_r2c(plans_->forward, w.window  .get(), as_fftw(w.fft  .get()));
+  fftw_execute_dft_r2c(plans_->forward, w.window_t.get(), as_fftw(w.fft_t.get()));
+  fftw_execute_dft_r2c(plans_->forward, w.window_d.get(), as_fftw(w.fft_d.get()));
+
+  std::copy(w.fft  .get(), w.fft  .get() + fft_size(), X  );
+  std::copy(w.fft_t.get(), w.fft_t.get() + fft_size(), X_t);
+  std::copy(w.fft_d.get(), w.fft_d.get() + fft_size(), X_d);
+}
+
+void audio_transport::spectral::padded_fft::inverse(
+    const std::complex<double> * X,
+    double * x,
+    workspace & w) const {
+
+  // The inverse destroys its input
+  std::copy(X, X + fft_size(), w.fft.get());
+  fftw_execute_dft_c2r(plans_->inverse, as_fftw(w.fft.get()), w.output.get());
+
+  // Keep the center
+  std::copy(
+      w.output.get() + padding_samples,
+      w.output.get() + padding_samples + N,
+      x);
+}
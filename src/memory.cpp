@@ -0,0 +1,349 @@
+#include <cmath>
+#include <vector>
+#include <tuple>
+#include <complex>
+#include <cassert>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/memory.hpp"
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/spectral_kernel.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/stream.hpp"
+#include "audio_transport/equal_loudness.hpp"
+#include "audio_transport/automation.hpp"
+#include "audio_transport/context.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+typedef spectral::kernel::dynamic_config config;
+typedef std::vector<std::vector<spectral::point>> frames;
+typedef std::complex<double> complex;
+
+// Frames held between the stages of a streaming render
+const size_t ring_capacity = 2;
+
+config config_of(
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+  assert(sample_rate > 0);
+  assert(window_size > 0);
+
+  // Round the same way as analysis
+  size_t N = std::round(window_size * sample_rate);
+  while (N % (2 * overlap) != 0) N += 1;
+  return config(N, padding, overlap);
+}
+
+// The number of frames analysis makes of num_samples
+size_t num_frames(const config & c, size_t num_samples) {
+  size_t num_hops = num_samples/c.hop_samples();
+  if (num_hops < 2 * c.overlap()) return 0;
+  return num_hops - (2 * c.overlap() - 1);
+}
+
+// The number of samples synthesis makes of num_frames
+size_t num_samples(const config & c, size_t num_frames) {
+  return (num_frames + 2 * c.overlap() - 1) * c.hop_samples();
+}
+
+size_t frame_bytes(const config & c) {
+  return sizeof(std::vector<spectral::point>) + c.fft_size() * sizeof(spectral::point);
+}
+
+size_t bytes_of(const frames & points) {
+  size_t bytes = points.capacity() * sizeof(std::vector<spectral::point>);
+  for (const std::vector<spectral::point> & frame : points) {
+    bytes += frame.capacity() * sizeof(spectral::point);
+  }
+  return bytes;
+}
+
+size_t bytes_of(const std::vector<double> & audio) {
+  return audio.capacity() * sizeof(double);
+}
+
+// FFTW's plans, taken to hold about as much as the
+// input and output of the transforms they plan
+size_t plan_bytes(const config & c) {
+  return
+    c.padded_samples() * sizeof(double) +
+    c.fft_size() * sizeof(complex);
+}
+
+size_t workspace_bytes(const config & c) {
+  return
+    4 * c.padded_samples() * sizeof(double) +
+    3 * c.fft_size() * sizeof(complex);
+}
+
+// The three window tables
+size_t windows_bytes(const config & c) {
+  return 3 * c.window_samples() * sizeof(double);
+}
+
+// A thread's workspace and the buffers of one frame
+size_t analysis_scratch_bytes(const config & c) {
+  return
+    workspace_bytes(c) +
+    3 * c.window_samples() * sizeof(double) +
+    3 * c.fft_size() * sizeof(complex);
+}
+
+size_t synthesis_scratch_bytes(const config & c) {
+  return
+    workspace_bytes(c) +
+    c.window_samples() * sizeof(double) +
+    c.fft_size() * sizeof(complex);
+}
+
+// The masses, plan, phases and amplitudes of one frame,
+// at worst a mass every other bin
+size_t interpolation_scratch_bytes(const config & c) {
+  size_t num_masses = c.fft_size()/2 + 1;
+  return
+    2 * num_masses * sizeof(spectral_mass) +
+    2 * num_masses * sizeof(std::tuple<size_t, size_t, double>) +
+    3 * c.fft_size() * sizeof(double);
+}
+
+// Stages run one after the other, keeping the input
+// spectra until the interpolation is done and what
+// the context cached until the end
+void batch_peak(footprint & f, size_t input_spectra, size_t interpolated_spectra) {
+  size_t analysis_cache = f.analysis - input_spectra;
+  f.peak = f.audio + f.cached + std::max(
+      f.analysis + f.interpolation,
+      analysis_cache + interpolated_spectra + f.synthesis);
+}
+
+// Every stage runs at once
+void streaming_peak(footprint & f) {
+  f.peak = f.audio + f.cached + f.analysis + f.interpolation + f.synthesis;
+}
+
+}
+
+audio_transport::footprint audio_transport::predict_footprint(
+    size_t num_samples,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    unsigned int num_threads) {
+
+  config c = config_of(sample_rate, window_size, padding, overlap);
+  size_t frames = num_frames(c, num_samples);
+  size_t spectra = frames * frame_bytes(c);
+
+  // Each thread working on a stage leases its own workspace,
+  // the plans and windows are shared
+  size_t num_hops = frames + 2 * overlap - 1;
+  size_t analysis_threads = std::max<size_t>(1, std::min<size_t>(num_threads, frames));
+  size_t synthesis_threads = std::max<size_t>(1, std::min<size_t>(num_threads, num_hops));
+
+  footprint f;
+  f.audio = (2 * num_samples + ::num_samples(c, frames)) * sizeof(double);
+  f.analysis =
+    2 * spectra +
+    plan_bytes(c) + windows_bytes(c) +
+    analysis_threads * analysis_scratch_bytes(c);
+  f.interpolation = spectra + interpolation_scratch_bytes(c);
+  f.synthesis = synthesis_threads * synthesis_scratch_bytes(c);
+  batch_peak(f, 2 * spectra, spectra);
+  return f;
+}
+
+audio_transport::footprint audio_transport::predict_streaming_footprint(
+    size_t num_samples,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+
+  config c = config_of(sample_rate, window_size, padding, overlap);
+  size_t ring = ring_capacity * frame_bytes(c);
+
+  footprint f;
+  f.audio = (2 * num_samples + ::num_samples(c, num_frames(c, num_samples))) * sizeof(double);
+  // Two analyzers, each with a history and a ring, sharing
+  // the plans and windows
+  f.analysis =
+    2 * (
+      ring +
+      analysis_scratch_bytes(c) +
+      c.window_samples() * sizeof(double)) +
+    plan_bytes(c) + windows_bytes(c);
+  // The phases, the weighted inputs, the frame
+  // and the output ring
+  f.interpolation =
+    ring +
+    3 * frame_bytes(c) +
+    c.fft_size() * sizeof(double) +
+    interpolation_scratch_bytes(c);
+  // The synthesizer has two workspaces and an accumulator
+  f.synthesis =
+    2 * synthesis_scratch_bytes(c) +
+    c.window_samples() * sizeof(double);
+  streaming_peak(f);
+  return f;
+}
+
+std::vector<double> audio_transport::transport(
+    const std::vector<double> & left,
+    const std::vector<double> & right,
+    double sample_rate,
+    const curve & interpolation_factor,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    size_t memory_budget,
+    footprint * counted) {
+  return transport(
+      default_context(),
+      left,
+      right,
+      sample_rate,
+      interpolation_factor,
+      window_size,
+      padding,
+      overlap,
+      memory_budget,
+      counted);
+}
+
+std::vector<double> audio_transport::transport(
+    context & ctx,
+    const std::vector<double> & left,
+    const std::vector<double> & right,
+    double sample_rate,
+    const curve & interpolation_factor,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    size_t memory_budget,
+    footprint * counted) {
+
+  config c = config_of(sample_rate, window_size, padding, overlap);
+  size_t length = std::min(left.size(), right.size());
+
+  footprint f;
+  std::vector<double> audio;
+
+  if (num_frames(c, length) == 0) {
+    f.audio = bytes_of(left) + bytes_of(right);
+    f.peak = f.audio;
+    if (counted) *counted = f;
+    return audio;
+  }
+
+  bool fits =
+    memory_budget == 0 or
+    predict_footprint(
+        length, sample_rate, window_size, padding, overlap, ctx.num_threads()).peak <= memory_budget;
+
+  // The context keeps what it caches until it is cleared
+  f.cached = ctx.bytes();
+
+  if (fits) {
+    frames points_left = spectral::analysis(ctx, left, sample_rate, window_size, padding, overlap);
+    frames points_right = spectral::analysis(ctx, right, sample_rate, window_size, padding, overlap);
+    equal_loudness::apply(points_left);
+    equal_loudness::apply(points_right);
+    size_t input_spectra = bytes_of(points_left) + bytes_of(points_right);
+    f.analysis = input_spectra + ctx.bytes() - f.cached;
+
+    frames points_interpolated = interpolate(
+        ctx,
+        points_left, points_right, window_size, interpolation_factor, overlap);
+    size_t interpolated_spectra = bytes_of(points_interpolated);
+    equal_loudness::remove(points_interpolated);
+    f.interpolation = interpolated_spectra + interpolation_scratch_bytes(c);
+
+    // Free the inputs before synthesis
+    frames().swap(points_left);
+    frames().swap(points_right);
+
+    size_t cached = ctx.bytes();
+    audio = spectral::synthesis(ctx, points_interpolated, padding, overlap);
+    f.synthesis = ctx.bytes() - cached;
+
+    f.audio = bytes_of(left) + bytes_of(right) + bytes_of(audio);
+    batch_peak(f, input_spectra, interpolated_spectra);
+
+  } else {
+    spectral::stream_analyzer left_analyzer(ctx, sample_rate, window_size, padding, overlap);
+    spectral::stream_analyzer right_analyzer(ctx, sample_rate, window_size, padding, overlap);
+    size_t analysis_cache = ctx.bytes() - f.cached;
+    spectral::stream_synthesizer synthesizer(ctx, left_analyzer.fft_size(), padding, overlap);
+
+    size_t fft_size = left_analyzer.fft_size();
+    spectral::frame_ring<spectral::point> left_frames(ring_capacity, fft_size);
+    spectral::frame_ring<spectral::point> right_frames(ring_capacity, fft_size);
+    spectral::frame_ring<spectral::point> interpolated(ring_capacity, fft_size);
+
+    // Frames are copied out of the rings to be weighted
+    std::vector<spectral::point> left_frame(fft_size), right_frame(fft_size);
+    std::vector<double> phases(fft_size, 0);
+
+    size_t hop = c.hop_samples();
+    size_t frames_left = num_frames(c, length);
+    audio.resize(num_samples(c, frames_left));
+
+    // One hop at a time, interpolating a frame while
+    // there are any and adding it to the output
+    size_t l = 0, r = 0;
+    for (size_t out = 0; out < audio.size(); out += hop) {
+      if (frames_left > 0) {
+        while (left_frames.size() == 0) {
+          l += left_analyzer.write(left.data() + l, std::min(hop, left.size() - l), left_frames);
+        }
+        while (right_frames.size() == 0) {
+          r += right_analyzer.write(right.data() + r, std::min(hop, right.size() - r), right_frames);
+        }
+        left_frame = *left_frames.front();
+        right_frame = *right_frames.front();
+        left_frames.pop();
+        right_frames.pop();
+        equal_loudness::apply(left_frame);
+        equal_loudness::apply(right_frame);
+
+        double interpolation = interpolation_factor(left_frame[0].time);
+        interpolation = std::min(1., std::max(0., interpolation));
+        std::vector<spectral::point> frame =
+          interpolate(left_frame, right_frame, phases, window_size, interpolation, overlap);
+        equal_loudness::remove(frame);
+
+        // The synthesizer takes a frame every hop, so there is room
+        std::vector<spectral::point> * output = interpolated.reserve();
+        assert(output);
+        std::copy(frame.begin(), frame.end(), output->begin());
+        interpolated.push();
+        frames_left--;
+      }
+      synthesizer.read(audio.data() + out, hop, interpolated);
+    }
+
+    f.audio = bytes_of(left) + bytes_of(right) + bytes_of(audio);
+    f.analysis =
+      left_analyzer.bytes() + right_analyzer.bytes() +
+      left_frames.bytes() + right_frames.bytes() +
+      analysis_cache;
+    f.interpolation =
+      phases.capacity() * sizeof(double) + interpolated.bytes() +
+      3 * frame_bytes(c) +
+      interpolation_scratch_bytes(c);
+    f.synthesis =
+      synthesizer.bytes() +
+      ctx.bytes() - f.cached - analysis_cache;
+    streaming_peak(f);
+  }
+
+  if (counted) *counted = f;
+  return audio;
+}
@@ -0,0 +1,220 @@
+#include <vector>
+#include <mutex>
+#include <cmath>
+#include <complex>
+#include <cassert>
+#include <ciso646>
+
+#include <fftw3.h>
+
+#include "audio_transport/fft.hpp"
+#include "audio_transport/pruned_fft.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+// Row stride of the residue buffers
+// Keeps every row aligned like the start of the buffer
+size_t row_stride(size_t N) {
+  return (N + 7) & ~size_t(7);
+}
+
+fftw_complex * as_fftw(std::complex<double> * x) {
+  return reinterpret_cast<fftw_complex *>(x);
+}
+
+template <class T>
+T * allocate(size_t n) {
+  return (T *) fftw_malloc(sizeof(T) * n);
+}
+
+}
+
+struct audio_transport::spectral::pruned_fft::plans {
+  fftw_plan forward;
+  fftw_plan backward;
+  fftw_plan forward_real;
+  fftw_plan inverse_real;
+};
+
+void audio_transport::spectral::pruned_fft::workspace::deleter::operator()(
+    void * p) const {
+  fftw_free(p);
+}
+
+audio_transport::spectral::pruned_fft::workspace::workspace(
+    const pruned_fft & fft) :
+  bytes_(
+      row_stride(fft.N) * (2 + fft.L + fft.L/2 + 1) * sizeof(std::complex<double>) +
+      row_stride(fft.N) * sizeof(double)),
+  input     (allocate<std::complex<double>>(row_stride(fft.N))),
+  output    (allocate<std::complex<double>>(row_stride(fft.N))),
+  residues  (allocate<std::complex<double>>(row_stride(fft.N) * fft.L)),
+  residues_d(allocate<std::complex<double>>(row_stride(fft.N) * (fft.L/2 + 1))),
+  real      (allocate<double>(row_stride(fft.N))) {
+}
+
+audio_transport::spectral::pruned_fft::pruned_fft(
+    size_t window_samples,
+    unsigned int padding) :
+  N(window_samples),
+  L(1 + padding),
+  twiddles(N * L),
+  shifts(2 * L),
+  plans_(new plans) {
+
+  size_t N_padded = N * L;
+  size_t padding_samples = (N_padded - N)/2;
+
+  // The shifts repeat every 2L bins only if the frame
+  // sits exactly in the middle of the padding
+  assert((N_padded - N) % 2 == 0);
+  assert(2 * padding_samples == N * (L - 1));
+
+  // Modulations that select each residue
+  for (size_t r = 0; r < L; r++) {
+    for (size_t n = 0; n < N; n++) {
+      twiddles[r * N + n] = std::polar(1., -2 * M_PI * ((r * n) % N_padded)/(double) N_padded);
+    }
+  }
+
+  // Phase ramp of the frame's offset into the padding
+  for (size_t k = 0; k < shifts.size(); k++) {
+    shifts[k] = std::polar(1., -2 * M_PI * ((k * padding_samples) % N_padded)/(double) N_padded);
+  }
+
+  // Plan on scratch buffers aligned like the workspaces
+  std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+  fftw_complex * in  = allocate<fftw_complex>(N);
+  fftw_complex * out = allocate<fftw_complex>(N);
+  double * real      = allocate<double>(N);
+  plans_->forward      = fftw_plan_dft_1d(N, in, out, FFTW_FORWARD, FFTW_MEASURE);
+  plans_->backward     = fftw_plan_dft_1d(N, in, out, FFTW_BACKWARD, FFTW_MEASURE);
+  plans_->forward_real = fftw_plan_dft_r2c_1d(N, real, out, FFTW_MEASURE);
+  plans_->inverse_real = fftw_plan_dft_c2r_1d(N, in, real, FFTW_MEASURE);
+  fftw_free(in);
+  fftw_free(out);
+  fftw_free(real);
+}
+
+audio_transport::spectral::pruned_fft::~pruned_fft() {
+  std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+  fftw_destroy_plan(plans_->forward);
+  fftw_destroy_plan(plans_->backward);
+  fftw_destroy_plan(plans_->forward_real);
+  fftw_destroy_plan(plans_->inverse_real);
+}
+
+size_t audio_transport::spectral::pruned_fft::bytes() const {
+  return
+    sizeof(*this) + sizeof(plans) +
+    (twiddles.capacity() + shifts.capacity()) * sizeof(std::complex<double>) +
+    2 * N * sizeof(std::complex<double>);
+}
+
+void audio_transport::spectral::pruned_fft::forward(
+    const double * x,
+    const double * x_t,
+    const double * x_d,
+    std::complex<double> * X,
+    std::complex<double> * X_t,
+    std::complex<double> * X_d,
+    workspace & w) const {
+
+  size_t stride = row_stride(N);
+  const std::complex<double> I(0, 1);
+
+  // Pack the two windows into one complex signal
+  // and transform every residue of it
+  for (size_t r = 0; r < L; r++) {
+    const std::complex<double> * twiddle = twiddles.data() + r * N;
+    for (size_t n = 0; n < N; n++) {
+      w.input[n] = std::complex<double>(x[n], x_t[n]) * twiddle[n];
+    }
+    fftw_execute_dft(plans_->forward, as_fftw(w.input.get()), as_fftw(w.residues.get() + r * stride));
+  }
+
+  // The derivative window is real so the
+  // upper residues mirror the lower ones
+  for (size_t n = 0; n < N; n++) {
+    w.real[n] = x_d[n];
+  }
+  fftw_execute_dft_r2c(plans_->forward_real, w.real.get(), as_fftw(w.residues_d.get()));
+  for (size_t r = 1; 2 * r <= L; r++) {
+    const std::complex<double> * twiddle = twiddles.data() + r * N;
+    for (size_t n = 0; n < N; n++) {
+      w.input[n] = x_d[n] * twiddle[n];
+    }
+    fftw_execute_dft(plans_->forward, as_fftw(w.input.get()), as_fftw(w.residues_d.get() + r * stride));
+  }
+
+  // Gather the bins
+  size_t half = N * L/2;
+  for (size_t m = 0, k = 0; k <= half; m++) {
+    for (size_t r = 0; r < L and k <= half; r++, k++) {
+      // The residue and index of the mirrored bin
+      size_t r_mirror = (r == 0) ? 0 : L - r;
+      size_t m_mirror = (r == 0) ? (N - m) % N : N - m - 1;
+
+      // Separate the packed transforms
+      std::complex<double> Z        = w.residues[r * stride + m];
+      std::complex<double> Z_mirror = std::conj(w.residues[r_mirror * stride + m_mirror]);
+      std::complex<double> Z_x   = 0.5 * (Z + Z_mirror);
+      std::complex<double> Z_x_t = -0.5 * I * (Z - Z_mirror);
+
+      std::complex<double> Z_x_d;
+      if (r == 0) {
+        Z_x_d = w.residues_d[m];
+      } else if (2 * r <= L) {
+        Z_x_d = w.residues_d[r * stride + m];
+      } else {
+        Z_x_d = std::conj(w.residues_d[r_mirror * stride + m_mirror]);
+      }
+
+      // Shift the frame into the center of the padding
+      const std::complex<double> & shift = shifts[k % shifts.size()];
+      X  [k] = shift * Z_x;
+      X_t[k] = shift * Z_x_t;
+      X_d[k] = shift * Z_x_d;
+    }
+  }
+}
+
+void audio_transport::spectral::pruned_fft::inverse(
+    const std::complex<double> * X,
+    double * x,
+    workspace & w) const {
+
+  size_t N_padded = N * L;
+  size_t half = N_padded/2;
+
+  // The zeroth residue is hermitian so its
+  // transform is real
+  for (size_t m = 0; m <= N/2; m++) {
+    size_t k = L * m;
+    w.input[m] = X[k] * std::conj(shifts[k % shifts.size()]);
+  }
+  fftw_execute_dft_c2r(plans_->inverse_real, as_fftw(w.input.get()), w.real.get());
+  for (size_t q = 0; q < N; q++) {
+    x[q] = w.real[q];
+  }
+
+  // Residues r and L - r contribute complex
+  // conjugates of each other
+  for (size_t r = 1; 2 * r <= L; r++) {
+    double weight = (2 * r == L) ? 1 : 2;
+
+    for (size_t m = 0; m < N; m++) {
+      size_t k = L * m + r;
+      std::complex<double> value = (k <= half) ? X[k] : std::conj(X[N_padded - k]);
+      w.input[m] = value * std::conj(shifts[k % shifts.size()]);
+    }
+    fftw_execute_dft(plans_->backward, as_fftw(w.input.get()), as_fftw(w.output.get()));
+
+    const std::complex<double> * twiddle = twiddles.data() + r * N;
+    for (size_t q = 0; q < N; q++) {
+      x[q] += weight * std::real(std::conj(twiddle[q]) * w.output[q]);
+    }
+  }
+}
@@ -3,183 +3,566 @@
 #include <complex>
 #include <ciso646>
 #include <cassert>
-
-#include <fftw3.h>
+#include <memory>
+#include <algorithm>
+#include <mutex>
 
 #include "audio_transport/spectral.hpp"
+#include "audio_transport/spectral_kernel.hpp"
+#include "audio_transport/fft.hpp"
+#include "audio_transport/pruned_fft.hpp"
+#include "audio_transport/context.hpp"
 
 using namespace audio_transport;
 
-std::vector<double> audio_transport::spectral::synthesis(
-    const std::vector<std::vector<spectral::point>> & points,
-    unsigned int padding,
-    unsigned int overlap) {
+namespace {
 
-  // Initialize the window
-  std::vector<double> window_padded(2 * (points[0].size() - 1));
-  size_t window_size = window_padded.size()/(1 + padding);
-  size_t padding_samples = (window_padded.size() - window_size)/2;
+// The smallest padding for which the automatic
+// transform skips the padding. Below this the
+// window sized FFTs cost about as much as one
+// padded real FFT.
+const unsigned int pruned_min_padding = 5;
+
+bool use_pruned(spectral::transform method, unsigned int padding) {
+  if (method == spectral::transform::automatic) {
+    return padding >= pruned_min_padding;
+  }
+  return method == spectral::transform::pruned;
+}
+
+/**
+ * A transform workspace and the frame buffers around it
+ */
+template <class Transform>
+struct analysis_frame {
+  analysis_frame(const Transform & fft) :
+    workspace(fft),
+    window  (fft.window_samples()),
+    window_t(fft.window_samples()),
+    window_d(fft.window_samples()),
+    spectrum  (fft.fft_size()),
+    spectrum_t(fft.fft_size()),
+    spectrum_d(fft.fft_size()) {}
+
+  size_t bytes() const {
+    return
+      sizeof(*this) + workspace.bytes() +
+      3 * window.capacity() * sizeof(double) +
+      3 * spectrum.capacity() * sizeof(std::complex<double>);
+  }
+
+  typename Transform::workspace workspace;
+  std::vector<double> window, window_t, window_d;
+  std::vector<std::complex<double>> spectrum, spectrum_t, spectrum_d;
+};
+
+template <class Transform>
+struct synthesis_frame {
+  synthesis_frame(const Transform & fft) :
+    workspace(fft),
+    spectrum(fft.fft_size()),
+    window(fft.window_samples()) {}
+
+  size_t bytes() const {
+    return
+      sizeof(*this) + workspace.bytes() +
+      spectrum.capacity() * sizeof(std::complex<double>) +
+      window.capacity() * sizeof(double);
+  }
+
+  typename Transform::workspace workspace;
+  std::vector<std::complex<double>> spectrum;
+  std::vector<double> window;
+};
+
+template <class Config>
+context::signature signature_of(const Config & config, double sample_rate = 0) {
+  return context::signature(
+      config.window_samples(),
+      config.padding(),
+      config.overlap(),
+      sample_rate);
+}
+
+template <class Config, class Transform>
+std::vector<double> synthesize(
+    context & ctx,
+    const Config & config,
+    const std::vector<std::vector<spectral::point>> & points) {
 
   // Initialize the audio
   // Accounting for an overlap factor of 2 * overlap
-  size_t hop_size = window_size/(2 * overlap);
-  size_t num_hops = points.size() + 2 * overlap - 1;
+  size_t hop_size = config.hop_samples();
+  size_t frame_hops = 2 * config.overlap();
+  size_t num_hops = points.size() + frame_hops - 1;
   std::vector<double> audio(num_hops * hop_size, 0);
 
-  // Initialize FFT
-  fftw_complex * fft;
-  fft = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * points[0].size());
-  fftw_plan fft_plan = fftw_plan_dft_c2r_1d(
-      window_padded.size(),
-      fft,
-      window_padded.data(),
-      FFTW_MEASURE);
+  // Get the FFT
+  std::shared_ptr<const Transform> fft = ctx.shared<Transform>(
+      signature_of(config),
+      [&] { return new Transform(config.window_samples(), config.padding()); });
 
-  // Iterate over the windows
-  for (size_t w = 0; w < points.size(); w++) {
-
-    // Fill the FFT
+  // Inverse transform frame w into a workspace
+  auto transform = [&](size_t w, synthesis_frame<Transform> & frame) {
     for (size_t i = 0; i < points[w].size(); i++) {
-      fft[i][0] = std::real(points[w][i].value);
-      fft[i][1] = std::imag(points[w][i].value);
+      frame.spectrum[i] = points[w][i].value;
     }
-    
-    // Execute the plans
-    fftw_execute(fft_plan);
-
-    // Apply the weighted overlap add
-    for (size_t i = 0; i < window_size; i++) {
-      // Scale down to correct for FFT and overlap sizes
-      double value = window_padded[i + padding_samples]/(overlap * window_padded.size());
+    fft->inverse(frame.spectrum.data(), frame.window.data(), frame.workspace);
+  };
+  auto acquire = [&] {
+    return ctx.acquire<synthesis_frame<Transform>>(
+        signature_of(config),
+        [&] { return new synthesis_frame<Transform>(*fft); });
+  };
+
+  if (ctx.deterministic()) {
+    // Each thread owns a range of hops of the audio and adds
+    // every frame that covers it in order, so each sample is
+    // summed in the same order at any number of threads
+    ctx.parallel_for(num_hops, [&](size_t begin, size_t end) {
+      context::lease<synthesis_frame<Transform>> frame = acquire();
+
+      size_t first = begin < frame_hops ? 0 : begin - (frame_hops - 1);
+      size_t last = std::min(end, points.size());
+      for (size_t w = first; w < last; w++) {
+        transform(w, *frame);
+
+        // Apply the weighted overlap add
+        spectral::kernel::overlap_add(
+            config,
+            frame->window.data(),
+            audio.data() + w * hop_size,
+            (std::max(begin, w) - w) * hop_size,
+            (std::min(end, w + frame_hops) - w) * hop_size);
+      }
+    });
+    return audio;
+  }
 
-      // Add it to the overlapped signal
-      audio[i + w * window_size/(2 * overlap)] += value;
+  // Each thread adds a range of frames into its own
+  // audio, which is added to the output as it finishes
+  std::mutex mutex;
+  ctx.parallel_for(points.size(), [&](size_t begin, size_t end) {
+    context::lease<synthesis_frame<Transform>> frame = acquire();
+
+    std::vector<double> part((end - begin + frame_hops - 1) * hop_size, 0);
+    for (size_t w = begin; w < end; w++) {
+      transform(w, *frame);
+      spectral::kernel::overlap_add(
+          config,
+          frame->window.data(),
+          part.data() + (w - begin) * hop_size);
     }
-  }
 
-  // Cleanup
-  fftw_destroy_plan(fft_plan);
-  fftw_free(fft);
+    // Only the hops at either end are shared with other threads
+    double * output = audio.data() + begin * hop_size;
+    size_t shared = std::min(part.size(), (frame_hops - 1) * hop_size);
+    size_t owned = std::max(shared, part.size() - shared);
+    for (size_t i = shared; i < owned; i++) {
+      output[i] += part[i];
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < shared; i++) {
+      output[i] += part[i];
+    }
+    for (size_t i = owned; i < part.size(); i++) {
+      output[i] += part[i];
+    }
+  });
 
   return audio;
 }
 
-std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::analysis(
+/**
+ * Leaves the frames of analysis as they are
+ */
+struct single_resolution {
+  template <class Transform>
+  void operator()(
+      const Transform &,
+      analysis_frame<Transform> &,
+      const double *,
+      double,
+      spectral::point *) const {}
+};
+
+/**
+ * Replaces the bins above the crossover of frames that hold
+ * a transient with those of a short window centered on it
+ * (see multiresolution_analysis).
+ */
+template <class Config>
+class transient_sharpener {
+ public:
+  transient_sharpener(
+      context & ctx,
+      const Config & config,
+      double sample_rate,
+      const spectral::multiresolution_options & options) :
+    config(config),
+    sample_rate(sample_rate),
+    options(options),
+    short_config(short_window_samples(config, sample_rate, options), 0, 1) {
+
+    // Share the short window tables like the long ones
+    short_windows = ctx.shared<spectral::kernel::windows<spectral::kernel::dynamic_config>>(
+        signature_of(short_config, sample_rate),
+        [&] { return new spectral::kernel::windows<spectral::kernel::dynamic_config>(short_config, sample_rate); });
+
+    crossover_bin = std::ceil(options.crossover * config.padded_samples()/sample_rate);
+    // The spacing of unpadded bins (radians per second)
+    bin_width = 2 * M_PI * sample_rate/config.window_samples();
+  }
+
+  template <class Transform>
+  void operator()(
+      const Transform & fft,
+      analysis_frame<Transform> & frame,
+      const double * audio,
+      double time,
+      spectral::point * points) const {
+
+    const size_t N = config.window_samples();
+    const size_t N_short = short_config.window_samples();
+    const size_t fft_size = config.fft_size();
+    if (crossover_bin >= fft_size) return;
+
+    // Where the energy above the crossover
+    // lies in time and frequency
+    double energy = 0, high_energy = 0;
+    double time_sum = 0, time_squared_sum = 0, deviation_sum = 0;
+    for (size_t i = 0; i < fft_size; i++) {
+      double e = std::norm(points[i].value);
+      // Silent bins have no reassignment
+      if (e == 0) continue;
+      energy += e;
+      if (i < crossover_bin) continue;
+
+      double dt = points[i].time_reassigned - time;
+      high_energy += e;
+      time_sum += e * dt;
+      time_squared_sum += e * dt * dt;
+      deviation_sum += e * std::abs(points[i].freq_reassigned - points[i].freq);
+    }
+    if (high_energy == 0 or high_energy < options.min_energy * energy) return;
+
+    double offset = time_sum/high_energy;
+    double spread = std::sqrt(std::max(0., time_squared_sum/high_energy - offset * offset));
+    double deviation = deviation_sum/(high_energy * bin_width);
+    if (spread > options.max_time_spread or deviation > options.max_freq_deviation) return;
+
+    // Center the short window on the transient
+    double center = (N - 1)/2. + offset * sample_rate;
+    if (center < 0 or center > N - 1) return;
+    double start = std::round(center - (N_short - 1)/2.);
+    start = std::min(std::max(start, 0.), (double) (N - N_short));
+    size_t first = start;
+
+    // Near the edges of the frame the clamped short window may
+    // barely cover the transient, and matching the long window
+    // would divide by almost nothing, so leave it to the frames
+    // that overlap this one
+    double short_weight = spectral::hann(center - first - (N_short - 1)/2., N_short);
+    if (short_weight < 0.5) return;
+
+    // Time is measured from the center of the long window
+    double shift = (first + (N_short - 1)/2. - (N - 1)/2.)/sample_rate;
+    std::fill(frame.window.begin(), frame.window.end(), 0.);
+    std::fill(frame.window_t.begin(), frame.window_t.end(), 0.);
+    std::fill(frame.window_d.begin(), frame.window_d.end(), 0.);
+    for (size_t i = 0; i < N_short; i++) {
+      double a = audio[first + i];
+      frame.window  [first + i] = a * short_windows->hann[i];
+      frame.window_t[first + i] = a * (short_windows->hann_t[i] + shift * short_windows->hann[i]);
+      frame.window_d[first + i] = a * short_windows->hann_d[i];
+    }
+
+    fft.forward(
+        frame.window.data(),
+        frame.window_t.data(),
+        frame.window_d.data(),
+        frame.spectrum.data(),
+        frame.spectrum_t.data(),
+        frame.spectrum_d.data(),
+        frame.workspace);
+    spectral::kernel::reassign(
+        config,
+        frame.spectrum.data(),
+        frame.spectrum_t.data(),
+        frame.spectrum_d.data(),
+        time,
+        sample_rate,
+        points,
+        crossover_bin);
+
+    // Match the long window at the transient
+    // so overlap-add still sums to the audio
+    double scale = spectral::hann(center - (N - 1)/2., N)/short_weight;
+    for (size_t i = crossover_bin; i < fft_size; i++) {
+      points[i].value *= scale;
+    }
+  }
+
+ private:
+  static size_t short_window_samples(
+      const Config & config,
+      double sample_rate,
+      const spectral::multiresolution_options & options) {
+    size_t N_short = std::round(options.short_window_size * sample_rate);
+    // Make sure it is even for symmetry
+    if (N_short % 2 != 0) N_short += 1;
+    return std::max<size_t>(2, std::min(N_short, config.window_samples()));
+  }
+
+  Config config;
+  double sample_rate;
+  spectral::multiresolution_options options;
+
+  spectral::kernel::dynamic_config short_config;
+  std::shared_ptr<const spectral::kernel::windows<spectral::kernel::dynamic_config>> short_windows;
+
+  size_t crossover_bin;
+  double bin_width;
+};
+
+template <class Config, class Transform, class Refine>
+std::vector<std::vector<spectral::point>> analyze(
+    context & ctx,
+    const Config & config,
     const std::vector<double> & audio,
     double sample_rate,
-    double window_size,
-    unsigned int padding,
-    unsigned int overlap) {
-
-  // Make sure inputs are positive
-  assert(sample_rate > 0);
-  assert(window_size > 0);
+    const Refine & refine) {
 
-  // Convert the window size to samples
-  size_t N = std::round(window_size * sample_rate);
-  // Make sure it is even for symmetry
-  while (N % (2 * overlap) != 0) N += 1;
-  size_t N_padded = N * (1 + padding);
-  // Initialize the windows
-  std::vector<double> window(N_padded, 0), window_t(N_padded, 0), window_d(N_padded, 0);
+  size_t N = config.window_samples();
+  unsigned int overlap = config.overlap();
 
-  // Determine samples used for padding
-  size_t padding_samples = (N_padded - N)/2;
+  // Get the windows and the FFT
+  std::shared_ptr<const spectral::kernel::windows<Config>> windows =
+    ctx.shared<spectral::kernel::windows<Config>>(
+      signature_of(config, sample_rate),
+      [&] { return new spectral::kernel::windows<Config>(config, sample_rate); });
+  std::shared_ptr<const Transform> fft = ctx.shared<Transform>(
+      signature_of(config),
+      [&] { return new Transform(config.window_samples(), config.padding()); });
 
   // Compute the number of windows
-  // Accounting for an overlap factor of 2 * overlap
+  // Accounting for an overlap factor of 2 * overlap,
+  // and none for audio shorter than a window
   size_t num_hops = std::floor(audio.size()/(N/(2 * overlap)));
-  size_t num_windows = num_hops - (2 * overlap - 1);
-
-  // Initialize FFT
-  size_t fft_size = N_padded/2 + 1;
-  fftw_complex * fft, * fft_t, * fft_d;
-  fft   = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fft_t = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fft_d = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fftw_plan fft_plan    = fftw_plan_dft_r2c_1d(
-      window.size(),
-      window.data(),
-      fft,
-      FFTW_MEASURE);
-  fftw_plan fft_plan_t  = fftw_plan_dft_r2c_1d(
-      window_t.size(),
-      window_t.data(),
-      fft_t,
-      FFTW_MEASURE);
-  fftw_plan fft_plan_d  = fftw_plan_dft_r2c_1d(
-      window_d.size(),
-      window_d.data(),
-      fft_d,
-      FFTW_MEASURE);
+  size_t frame_hops = 2 * overlap;
+  size_t num_windows = num_hops < frame_hops ? 0 : num_hops - (frame_hops - 1);
 
   // Initialize the spectral points
   std::vector<std::vector<spectral::point>> points(num_windows);
 
   // Iterate over the windows
-  for (size_t w = 0; w < num_windows; w++) {
+  // Windows are independent so they can be split across threads
+  ctx.parallel_for(num_windows, [&](size_t begin, size_t end) {
+    context::lease<analysis_frame<Transform>> frame =
+      ctx.acquire<analysis_frame<Transform>>(
+        signature_of(config),
+        [&] { return new analysis_frame<Transform>(*fft); });
 
-    // Reserve space for each spectral point in each channel
-    points[w].reserve(fft_size);
+    for (size_t w = begin; w < end; w++) {
 
-    // Apply the various windows
-    for (size_t i = 0; i < N; i++) {
-      // The sample index of with window
-      // if the center of the window has n = 0
-      double n = i - (N - 1)/2.;
+      // Apply the various windows
+      // accounting for overlap of 2 * overlap
+      spectral::kernel::apply_windows(
+          config,
+          *windows,
+          audio.data() + w * N/(2 * overlap),
+          frame->window.data(),
+          frame->window_t.data(),
+          frame->window_d.data());
+
+      // Execute the plans
+      fft->forward(
+          frame->window.data(),
+          frame->window_t.data(),
+          frame->window_d.data(),
+          frame->spectrum.data(),
+          frame->spectrum_t.data(),
+          frame->spectrum_d.data(),
+          frame->workspace);
+
+      // Compute the center time
+      double t = ((N - 1)/2. + w * N/(2 * overlap))/sample_rate;
+
+      // Construct the spectral points
+      points[w].resize(config.fft_size());
+      spectral::kernel::reassign(
+          config,
+          frame->spectrum.data(),
+          frame->spectrum_t.data(),
+          frame->spectrum_d.data(),
+          t,
+          sample_rate,
+          points[w].data());
+
+      // Refine it with the same workspace
+      refine(
+          *fft,
+          *frame,
+          audio.data() + w * N/(2 * overlap),
+          t,
+          points[w].data());
+    }
+  });
 
-      // The audio sample to window accounting for overlap of 2 * overlap
-      double a = audio[i + w * N/(2 * overlap)];
+  return points;
+}
 
-      // Apply the various windows
-      window  [i + padding_samples] = a * hann  (n, N);
-      window_t[i + padding_samples] = a * hann_t(n, N, sample_rate);
-      window_d[i + padding_samples] = a * hann_d(n, N, sample_rate);
+struct analysis_function {
+  typedef std::vector<std::vector<spectral::point>> result_type;
+
+  context & ctx;
+  const std::vector<double> & audio;
+  double sample_rate;
+  spectral::transform method;
+  // Null for a single resolution
+  const spectral::multiresolution_options * multiresolution;
+
+  template <class Config>
+  result_type operator()(const Config & config) const {
+    if (multiresolution) {
+      return analyze<Config>(
+          config,
+          transient_sharpener<Config>(ctx, config, sample_rate, *multiresolution));
     }
+    return analyze<Config>(config, single_resolution());
+  }
 
-    // Execute the plans
-    fftw_execute(fft_plan);
-    fftw_execute(fft_plan_t);
-    fftw_execute(fft_plan_d);
+  template <class Config, class Refine>
+  result_type analyze(const Config & config, const Refine & refine) const {
+    if (use_pruned(method, config.padding())) {
+      return ::analyze<Config, spectral::pruned_fft>(ctx, config, audio, sample_rate, refine);
+    }
+    return ::analyze<Config, spectral::padded_fft>(ctx, config, audio, sample_rate, refine);
+  }
+};
 
-    // Compute the center time
-    double t = ((N - 1)/2. + w * N/(2 * overlap))/sample_rate;
+struct synthesis_function {
+  typedef std::vector<double> result_type;
 
-    for (size_t i = 0; i < fft_size; i++) {
-      // Convert to C++ complex
-      std::complex<double> X   (fft   [i][0], fft   [i][1]);
-      std::complex<double> X_t (fft_t [i][0], fft_t [i][1]);
-      std::complex<double> X_d (fft_d [i][0], fft_d [i][1]);
-
-      // Begin to construct a spectral point
-      spectral::point p;
-      p.value = X;
-      p.time = t;
-      p.freq = (2 * M_PI * i * sample_rate)/(double) N_padded;
-
-      // Compute how the frequency and time changed
-      std::complex<double> conj_over_norm = std::conj(X)/std::norm(X);
-      double dphase_domega =  std::real(X_t * conj_over_norm);
-      double dphase_dt     = -std::imag(X_d * conj_over_norm);
-
-      // Compute the reassigned time and frequency
-      p.time_reassigned = p.time + dphase_domega;
-      p.freq_reassigned = p.freq + dphase_dt;
-
-      // Add the point
-      points[w].push_back(p);
+  context & ctx;
+  const std::vector<std::vector<spectral::point>> & points;
+  spectral::transform method;
+
+  template <class Config>
+  result_type operator()(const Config & config) const {
+    if (use_pruned(method, config.padding())) {
+      return synthesize<Config, spectral::pruned_fft>(ctx, config, points);
     }
+    return synthesize<Config, spectral::padded_fft>(ctx, config, points);
   }
+};
 
-  // Cleanup
-  fftw_destroy_plan(fft_plan);
-  fftw_destroy_plan(fft_plan_t);
-  fftw_destroy_plan(fft_plan_d);
-  fftw_free(fft);
-  fftw_free(fft_t);
-  fftw_free(fft_d);
+}
 
-  return points;
+std::vector<double> audio_transport::spectral::synthesis(
+    const std::vector<std::vector<spectral::point>> & points,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) {
+  return synthesis(default_context(), points, padding, overlap, method);
+}
+
+std::vector<double> audio_transport::spectral::synthesis(
+    context & ctx,
+    const std::vector<std::vector<spectral::point>> & points,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) {
+  if (points.empty()) return std::vector<double>();
+
+  // Infer the window size from the number of bins
+  size_t N_padded = 2 * (points[0].size() - 1);
+  size_t window_size = N_padded/(1 + padding);
+
+  // Use a specialised kernel if one is registered
+  return kernel::dispatch(
+      kernel::registered(),
+      window_size,
+      padding,
+      overlap,
+      synthesis_function{ctx, points, method});
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::analysis(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) {
+  return analysis(default_context(), audio, sample_rate, window_size, padding, overlap, method);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::analysis(
+    context & ctx,
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) {
+
+  // Make sure inputs are positive
+  assert(sample_rate > 0);
+  assert(window_size > 0);
+
+  // Convert the window size to samples
+  size_t N = std::round(window_size * sample_rate);
+  // Make sure it is even for symmetry
+  while (N % (2 * overlap) != 0) N += 1;
+
+  // Use a specialised kernel if one is registered
+  return kernel::dispatch(
+      kernel::registered(),
+      N,
+      padding,
+      overlap,
+      analysis_function{ctx, audio, sample_rate, method, nullptr});
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::multiresolution_analysis(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    multiresolution_options options,
+    transform method) {
+  return multiresolution_analysis(
+      default_context(), audio, sample_rate, window_size, padding, overlap, options, method);
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::multiresolution_analysis(
+    context & ctx,
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    multiresolution_options options,
+    transform method) {
+
+  // Make sure inputs are positive
+  assert(sample_rate > 0);
+  assert(window_size > 0);
+  assert(options.short_window_size > 0);
+
+  // Convert the window size to samples
+  size_t N = std::round(window_size * sample_rate);
+  // Make sure it is even for symmetry
+  while (N % (2 * overlap) != 0) N += 1;
+
+  return kernel::dispatch(
+      kernel::registered(),
+      N,
+      padding,
+      overlap,
+      analysis_function{ctx, audio, sample_rate, method, &options});
 }
 
 double audio_transport::spectral::hann(
@@ -0,0 +1,463 @@
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/stream.hpp"
+#include "audio_transport/spectral_kernel.hpp"
+#include "audio_transport/fft.hpp"
+#include "audio_transport/pruned_fft.hpp"
+#include "audio_transport/context.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/automation.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+typedef spectral::kernel::dynamic_config config;
+
+// Same as the batch functions
+const unsigned int pruned_min_padding = 5;
+
+bool use_pruned(spectral::transform method, unsigned int padding) {
+  if (method == spectral::transform::automatic) {
+    return padding >= pruned_min_padding;
+  }
+  return method == spectral::transform::pruned;
+}
+
+context::signature signature_of(const config & c, double sample_rate = 0) {
+  return context::signature(c.window_samples(), c.padding(), c.overlap(), sample_rate);
+}
+
+/**
+ * One of the two transforms with a workspace of its own
+ */
+struct transforms {
+  transforms(
+      context & ctx,
+      const config & c,
+      spectral::transform method) {
+    if (use_pruned(method, c.padding())) {
+      pruned = ctx.shared<spectral::pruned_fft>(
+          signature_of(c),
+          [&] { return new spectral::pruned_fft(c.window_samples(), c.padding()); });
+      pruned_workspace.reset(new spectral::pruned_fft::workspace(*pruned));
+    } else {
+      padded = ctx.shared<spectral::padded_fft>(
+          signature_of(c),
+          [&] { return new spectral::padded_fft(c.window_samples(), c.padding()); });
+      padded_workspace.reset(new spectral::padded_fft::workspace(*padded));
+    }
+  }
+
+  void forward(
+      const double * x,
+      const double * x_t,
+      const double * x_d,
+      std::complex<double> * X,
+      std::complex<double> * X_t,
+      std::complex<double> * X_d) {
+    if (pruned) {
+      pruned->forward(x, x_t, x_d, X, X_t, X_d, *pruned_workspace);
+    } else {
+      padded->forward(x, x_t, x_d, X, X_t, X_d, *padded_workspace);
+    }
+  }
+
+  void inverse(const std::complex<double> * X, double * x) {
+    if (pruned) {
+      pruned->inverse(X, x, *pruned_workspace);
+    } else {
+      padded->inverse(X, x, *padded_workspace);
+    }
+  }
+
+  // The bytes of the workspace
+  size_t bytes() const {
+    return pruned ? pruned_workspace->bytes() : padded_workspace->bytes();
+  }
+
+  std::shared_ptr<const spectral::padded_fft> padded;
+  std::unique_ptr<spectral::padded_fft::workspace> padded_workspace;
+  std::shared_ptr<const spectral::pruned_fft> pruned;
+  std::unique_ptr<spectral::pruned_fft::workspace> pruned_workspace;
+};
+
+}
+
+//////////////
+// Analysis
+//////////////
+
+struct audio_transport::spectral::stream_analyzer::state {
+  state(
+      context & ctx,
+      double sample_rate,
+      size_t window_samples,
+      unsigned int padding,
+      unsigned int overlap,
+      transform method) :
+    c(window_samples, padding, overlap),
+    sample_rate(sample_rate),
+    windows(ctx.shared<kernel::windows<config>>(
+          signature_of(c, sample_rate),
+          [&] { return new kernel::windows<config>(c, sample_rate); })),
+    fft(ctx, c, method),
+    history(window_samples, 0),
+    filled(0),
+    num_frames(0),
+    window  (window_samples),
+    window_t(window_samples),
+    window_d(window_samples),
+    spectrum  (c.fft_size()),
+    spectrum_t(c.fft_size()),
+    spectrum_d(c.fft_size()) {}
+
+  config c;
+  double sample_rate;
+  std::shared_ptr<const kernel::windows<config>> windows;
+  transforms fft;
+
+  // The audio of the next frame
+  std::vector<double> history;
+  size_t filled;
+  size_t num_frames;
+
+  std::vector<double> window, window_t, window_d;
+  std::vector<std::complex<double>> spectrum, spectrum_t, spectrum_d;
+};
+
+namespace {
+
+size_t window_samples_of(double window_size, double sample_rate, unsigned int overlap) {
+  assert(sample_rate > 0);
+  assert(window_size > 0);
+
+  // Round the same way as analysis
+  size_t N = std::round(window_size * sample_rate);
+  while (N % (2 * overlap) != 0) N += 1;
+  return N;
+}
+
+}
+
+audio_transport::spectral::stream_analyzer::stream_analyzer(
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) :
+  stream_analyzer(default_context(), sample_rate, window_size, padding, overlap, method) {}
+
+audio_transport::spectral::stream_analyzer::stream_analyzer(
+    context & ctx,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) :
+  s(new state(
+        ctx,
+        sample_rate,
+        window_samples_of(window_size, sample_rate, overlap),
+        padding,
+        overlap,
+        method)) {}
+
+audio_transport::spectral::stream_analyzer::~stream_analyzer() {}
+
+size_t audio_transport::spectral::stream_analyzer::window_samples() const {
+  return s->c.window_samples();
+}
+
+size_t audio_transport::spectral::stream_analyzer::hop_samples() const {
+  return s->c.hop_samples();
+}
+
+size_t audio_transport::spectral::stream_analyzer::fft_size() const {
+  return s->c.fft_size();
+}
+
+size_t audio_transport::spectral::stream_analyzer::bytes() const {
+  return sizeof(state) + s->fft.bytes() +
+    (s->history.capacity() +
+     s->window.capacity() +
+     s->window_t.capacity() +
+     s->window_d.capacity()) * sizeof(double) +
+    (s->spectrum.capacity() +
+     s->spectrum_t.capacity() +
+     s->spectrum_d.capacity()) * sizeof(std::complex<double>);
+}
+
+size_t audio_transport::spectral::stream_analyzer::write(
+    const double * audio,
+    size_t n,
+    frame_ring<point> & frames) {
+  assert(frames.frame_size() == fft_size());
+
+  const size_t N = s->c.window_samples();
+  const size_t hop = s->c.hop_samples();
+
+  size_t consumed = 0;
+  while (true) {
+    if (s->filled == N) {
+      // Wait for room rather than drop the frame
+      std::vector<point> * frame = frames.reserve();
+      if (not frame) break;
+
+      kernel::apply_windows(
+          s->c,
+          *s->windows,
+          s->history.data(),
+          s->window.data(),
+          s->window_t.data(),
+          s->window_d.data());
+      s->fft.forward(
+          s->window.data(),
+          s->window_t.data(),
+          s->window_d.data(),
+          s->spectrum.data(),
+          s->spectrum_t.data(),
+          s->spectrum_d.data());
+
+      // The center time as in analysis
+      double t = ((N - 1)/2. + s->num_frames * hop)/s->sample_rate;
+      kernel::reassign(
+          s->c,
+          s->spectrum.data(),
+          s->spectrum_t.data(),
+          s->spectrum_d.data(),
+          t,
+          s->sample_rate,
+          frame->data());
+      frames.push();
+      s->num_frames++;
+
+      // Keep the overlapping part for the next frame
+      std::copy(s->history.begin() + hop, s->history.end(), s->history.begin());
+      s->filled = N - hop;
+    }
+
+    if (consumed == n) break;
+
+    size_t m = std::min(n - consumed, N - s->filled);
+    std::copy(audio + consumed, audio + consumed + m, s->history.begin() + s->filled);
+    s->filled += m;
+    consumed += m;
+  }
+
+  return consumed;
+}
+
+///////////////
+// Synthesis
+///////////////
+
+struct audio_transport::spectral::stream_synthesizer::state {
+  state(
+      context & ctx,
+      size_t window_samples,
+      unsigned int padding,
+      unsigned int overlap,
+      transform method) :
+    c(window_samples, padding, overlap),
+    read_fft(ctx, c, method),
+    read_spectrum(c.fft_size()),
+    read_grain(window_samples),
+    synthesize_fft(ctx, c, method),
+    synthesize_spectrum(c.fft_size()),
+    output(window_samples, 0),
+    position(c.hop_samples()) {}
+
+  config c;
+
+  // Used by read
+  transforms read_fft;
+  std::vector<std::complex<double>> read_spectrum;
+  std::vector<double> read_grain;
+
+  // Used by synthesize
+  transforms synthesize_fft;
+  std::vector<std::complex<double>> synthesize_spectrum;
+
+  // The sum of the frames so far, starting at the current hop
+  std::vector<double> output;
+  // How much of the current hop has been read
+  size_t position;
+};
+
+namespace {
+
+size_t window_samples_of(size_t fft_size, unsigned int padding) {
+  // Infer the window size from the number of bins
+  size_t N_padded = 2 * (fft_size - 1);
+  return N_padded/(1 + padding);
+}
+
+}
+
+audio_transport::spectral::stream_synthesizer::stream_synthesizer(
+    size_t fft_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) :
+  stream_synthesizer(default_context(), fft_size, padding, overlap, method) {}
+
+audio_transport::spectral::stream_synthesizer::stream_synthesizer(
+    context & ctx,
+    size_t fft_size,
+    unsigned int padding,
+    unsigned int overlap,
+    transform method) :
+  s(new state(
+        ctx,
+        window_samples_of(fft_size, padding),
+        padding,
+        overlap,
+        method)) {}
+
+audio_transport::spectral::stream_synthesizer::~stream_synthesizer() {}
+
+size_t audio_transport::spectral::stream_synthesizer::window_samples() const {
+  return s->c.window_samples();
+}
+
+size_t audio_transport::spectral::stream_synthesizer::hop_samples() const {
+  return s->c.hop_samples();
+}
+
+size_t audio_transport::spectral::stream_synthesizer::bytes() const {
+  return sizeof(state) + s->read_fft.bytes() + s->synthesize_fft.bytes() +
+    (s->read_grain.capacity() +
+     s->output.capacity()) * sizeof(double) +
+    (s->read_spectrum.capacity() +
+     s->synthesize_spectrum.capacity()) * sizeof(std::complex<double>);
+}
+
+void audio_transport::spectral::stream_synthesizer::synthesize(
+    const std::vector<point> & frame,
+    std::vector<double> & grain) {
+  assert(frame.size() == s->synthesize_spectrum.size());
+  for (size_t i = 0; i < frame.size(); i++) {
+    s->synthesize_spectrum[i] = frame[i].value;
+  }
+  grain.resize(s->c.window_samples());
+  s->synthesize_fft.inverse(s->synthesize_spectrum.data(), grain.data());
+}
+
+template <class Frame, class Add>
+size_t audio_transport::spectral::stream_synthesizer::read(
+    double * audio,
+    size_t n,
+    frame_ring<Frame> & frames,
+    Add add) {
+
+  const size_t hop = s->c.hop_samples();
+
+  size_t taken = 0;
+  size_t written = 0;
+  while (written < n) {
+    if (s->position == hop) {
+      // Move on to the next hop
+      std::copy(s->output.begin() + hop, s->output.end(), s->output.begin());
+      std::fill(s->output.end() - hop, s->output.end(), 0.);
+      s->position = 0;
+
+      // Add the frame that starts here
+      const std::vector<Frame> * frame = frames.front();
+      if (frame) {
+        add(*frame);
+        frames.pop();
+        taken++;
+      }
+    }
+
+    size_t m = std::min(n - written, hop - s->position);
+    std::copy(
+        s->output.begin() + s->position,
+        s->output.begin() + s->position + m,
+        audio + written);
+    s->position += m;
+    written += m;
+  }
+
+  return taken;
+}
+
+size_t audio_transport::spectral::stream_synthesizer::read(
+    double * audio,
+    size_t n,
+    frame_ring<point> & frames) {
+  assert(frames.frame_size() == s->read_spectrum.size());
+  return read(audio, n, frames, [this](const std::vector<point> & frame) {
+      for (size_t i = 0; i < frame.size(); i++) {
+        s->read_spectrum[i] = frame[i].value;
+      }
+      s->read_fft.inverse(s->read_spectrum.data(), s->read_grain.data());
+      kernel::overlap_add(s->c, s->read_grain.data(), s->output.data());
+    });
+}
+
+size_t audio_transport::spectral::stream_synthesizer::read(
+    double * audio,
+    size_t n,
+    frame_ring<double> & grains) {
+  assert(grains.frame_size() == window_samples());
+  return read(audio, n, grains, [this](const std::vector<double> & grain) {
+      kernel::overlap_add(s->c, grain.data(), s->output.data());
+    });
+}
+
+///////////////////
+// Interpolation
+///////////////////
+
+audio_transport::stream_interpolator::stream_interpolator(
+    size_t fft_size,
+    double window_size,
+    unsigned int overlap) :
+  window_size(window_size),
+  overlap(overlap),
+  phases(fft_size, 0) {}
+
+size_t audio_transport::stream_interpolator::process(
+    spectral::frame_ring<spectral::point> & left,
+    spectral::frame_ring<spectral::point> & right,
+    spectral::frame_ring<spectral::point> & output,
+    const curve & interpolation_factor) {
+  assert(left.frame_size() == phases.size());
+  assert(right.frame_size() == phases.size());
+  assert(output.frame_size() == phases.size());
+
+  size_t processed = 0;
+  // Check the sizes first so that waiting
+  // is not counted as an underrun
+  while (left.size() > 0 and right.size() > 0 and output.size() < output.capacity()) {
+    const std::vector<spectral::point> & l = *left.front();
+    const std::vector<spectral::point> & r = *right.front();
+
+    double interpolation = interpolation_factor(l[0].time);
+    interpolation = std::min(1., std::max(0., interpolation));
+
+    std::vector<spectral::point> interpolated =
+      interpolate(l, r, phases, window_size, interpolation, overlap);
+
+    std::vector<spectral::point> & frame = *output.reserve();
+    std::copy(interpolated.begin(), interpolated.end(), frame.begin());
+    output.push();
+    left.pop();
+    right.pop();
+    processed++;
+  }
+
+  return processed;
+}
+
+size_t audio_transport::stream_interpolator::bytes() const {
+  return sizeof(*this) + phases.capacity() * sizeof(double);
+}
@@ -0,0 +1,140 @@
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <ciso646>
+
+#include "audio_transport/thread_pool.hpp"
+
+namespace {
+
+// The worker running on this thread, if any
+thread_local const audio_transport::thread_pool * current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+}
+
+audio_transport::thread_pool::thread_pool(unsigned int num_threads) :
+  queued(0),
+  unfinished(0),
+  stopping(false),
+  next_queue(0),
+  steals_(0) {
+
+  num_threads = std::max(1u, num_threads);
+  for (unsigned int i = 0; i < num_threads; i++) {
+    queues.emplace_back(new queue);
+  }
+  for (unsigned int i = 0; i < num_threads; i++) {
+    workers.emplace_back(&thread_pool::run, this, i);
+  }
+}
+
+audio_transport::thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+
+  // Workers finish what is queued before exiting
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+}
+
+void audio_transport::thread_pool::submit(std::function<void()> task) {
+  size_t index;
+  if (current_pool == this) {
+    index = current_index;
+  } else {
+    index = next_queue++ % queues.size();
+  }
+
+  // Count and publish the task together, so a worker can
+  // neither take it before it is counted nor find the count
+  // raised and the deque still empty
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued++;
+    unfinished++;
+    std::lock_guard<std::mutex> queue_lock(queues[index]->mutex);
+    queues[index]->tasks.push_back(std::move(task));
+  }
+  work_available.notify_one();
+}
+
+bool audio_transport::thread_pool::is_worker() const {
+  return current_pool == this;
+}
+
+void audio_transport::thread_pool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  all_done.wait(lock, [this] { return unfinished == 0; });
+
+  if (error) {
+    std::exception_ptr e = error;
+    error = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+bool audio_transport::thread_pool::pop(
+    size_t index,
+    std::function<void()> & task) {
+  // Newest first from our own deque
+  std::lock_guard<std::mutex> lock(queues[index]->mutex);
+  if (queues[index]->tasks.empty()) return false;
+  task = std::move(queues[index]->tasks.back());
+  queues[index]->tasks.pop_back();
+  return true;
+}
+
+bool audio_transport::thread_pool::steal(
+    size_t index,
+    std::function<void()> & task) {
+  // Oldest first from everyone else's
+  for (size_t i = 1; i < queues.size(); i++) {
+    queue & victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty()) continue;
+    task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    steals_++;
+    return true;
+  }
+  return false;
+}
+
+void audio_transport::thread_pool::run(size_t index) {
+  current_pool = this;
+  current_index = index;
+
+  while (true) {
+    std::function<void()> task;
+    if (pop(index, task) or steal(index, task)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued--;
+      }
+
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (not error) error = std::current_exception();
+      }
+      // Release anything the task holds before
+      // anyone waiting is told it is finished
+      task = nullptr;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--unfinished == 0) all_done.notify_all();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    work_available.wait(lock, [this] { return queued > 0 or stopping; });
+    if (stopping and queued == 0) return;
+  }
+}
@@ -0,0 +1,178 @@
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/tonal.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+// Table entries per padded bin
+const double oversampling = 64;
+
+// Transform of a rectangular window of N samples
+// centered on n = 0
+double dirichlet(double theta, double N) {
+  double denominator = std::sin(theta/2);
+  if (std::abs(denominator) < 1e-12) return N;
+  return std::sin(N * theta/2)/denominator;
+}
+
+// Transform of spectral::hann
+double hann_transform(double theta, double N) {
+  double alpha = 2 * M_PI/(N - 1);
+  return
+    0.5  * dirichlet(theta, N) +
+    0.25 * dirichlet(theta - alpha, N) +
+    0.25 * dirichlet(theta + alpha, N);
+}
+
+}
+
+audio_transport::tonal_renderer::tonal_renderer(
+    size_t fft_size,
+    unsigned int padding,
+    options opts) :
+  opts(opts),
+  N_padded(2 * (fft_size - 1)),
+  L(1 + padding) {
+
+  double N = N_padded/L;
+
+  // The hann main lobe spans two unpadded
+  // bins on either side of the center
+  reach = std::ceil((2 + opts.side_lobes) * L);
+
+  table.resize((reach + 1) * oversampling + 1);
+  double peak = hann_transform(0, N);
+  for (size_t i = 0; i < table.size(); i++) {
+    double theta = 2 * M_PI * (i/oversampling)/N_padded;
+    table[i] = hann_transform(theta, N)/peak;
+  }
+
+  step = std::polar(1., M_PI * (1 + 1./N_padded));
+}
+
+double audio_transport::tonal_renderer::response(double offset) const {
+  double index = std::abs(offset) * oversampling;
+  size_t i = index;
+  if (i + 1 >= table.size()) return 0;
+  double fraction = index - i;
+  return (1 - fraction) * table[i] + fraction * table[i + 1];
+}
+
+bool audio_transport::tonal_renderer::is_tonal(
+    const spectral_mass & mass,
+    const std::vector<spectral::point> & spectrum,
+    double total_magnitude) const {
+
+  // A resolved sinusoid covers at least half of its main lobe
+  if (mass.right_bin - mass.left_bin < 2 * L) return false;
+
+  double bin_freq = spectrum[1].freq;
+  double center_freq = spectrum[mass.center_bin].freq_reassigned;
+  double f = center_freq/bin_freq;
+
+  // The peak should reassign to within an unpadded bin
+  if (not (std::abs(f - mass.center_bin) <= L)) return false;
+
+  // Look over the main lobe
+  double lobe = 2 * L;
+  size_t begin = std::max<double>(mass.left_bin, std::ceil(f - lobe));
+  size_t end   = std::min<double>(mass.right_bin, std::floor(f + lobe) + 1);
+
+  double lobe_magnitude = 0;
+  double spread = 0;
+  for (size_t i = begin; i < end; i++) {
+    double magnitude = std::abs(spectrum[i].value);
+    if (not (magnitude > 0)) continue;
+    lobe_magnitude += magnitude;
+    spread += magnitude * std::abs(spectrum[i].freq_reassigned - center_freq);
+  }
+
+  double mass_magnitude = mass.mass * total_magnitude;
+  if (not (lobe_magnitude > 0) or not (mass_magnitude > 0)) return false;
+
+  // Almost all of the mass is in the main lobe
+  // and the lobe all reassigns to one frequency
+  return
+    lobe_magnitude >= opts.min_concentration * mass_magnitude and
+    spread/lobe_magnitude <= opts.max_spread * L * bin_freq;
+}
+
+double audio_transport::tonal_renderer::amplitude(
+    const spectral_mass & mass,
+    const std::vector<spectral::point> & spectrum) const {
+  double f = spectrum[mass.center_bin].freq_reassigned/spectrum[1].freq;
+  double r = response(mass.center_bin - f);
+  if (not (r > 0)) return 0;
+  return std::abs(spectrum[mass.center_bin].value)/r;
+}
+
+void audio_transport::tonal_renderer::render(
+    double amplitude,
+    int center_bin,
+    double interpolated_freq,
+    double center_phase,
+    std::vector<spectral::point> & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes) const {
+  render(
+      amplitude,
+      center_bin,
+      interpolated_freq,
+      center_phase,
+      output,
+      next_phase,
+      phases,
+      amplitudes,
+      0,
+      output.size());
+}
+
+void audio_transport::tonal_renderer::render(
+    double amplitude,
+    int center_bin,
+    double interpolated_freq,
+    double center_phase,
+    std::vector<spectral::point> & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes,
+    size_t begin,
+    size_t end) const {
+
+  double f = interpolated_freq/output[1].freq;
+  int first = std::max(0., std::ceil(f - reach));
+  int last  = std::min<double>(output.size(), std::floor(f + reach) + 1);
+  if (first >= last) return;
+
+  // The phase is center_phase at the center bin
+  // and alternates with the frame's offset into the padding.
+  // The recurrence always starts at the first bin so that
+  // every range rounds the same way.
+  std::complex<double> value = std::polar(
+      amplitude,
+      center_phase + M_PI * (first - center_bin) * (1 + 1./N_padded));
+
+  int stop = std::min<long>(last, end);
+  for (int i = first; i < stop; i++, value *= step) {
+    if (i < (long) begin) continue;
+
+    double r = response(i - f);
+    if (r == 0) continue;
+
+    output[i].value += r * value;
+
+    double mag = amplitude * std::abs(r);
+    if (mag > amplitudes[i]) {
+      amplitudes[i] = mag;
+      phases[i] = next_phase;
+      output[i].freq_reassigned = interpolated_freq;
+    }
+  }
+}
@@ -0,0 +1,156 @@
+#include <cmath>
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <ciso646>
+
+#include "audio_transport/transport_solver.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+// Where a mass sits in normalized (frequency, time) coordinates
+struct location {
+  double freq;
+  double time;
+};
+
+location locate(
+    const spectral_mass & mass,
+    const std::vector<spectral::point> & spectrum) {
+
+  location l;
+  l.freq = spectrum[mass.center_bin].freq_reassigned/spectrum.back().freq;
+
+  // Mass weighted offset of the reassigned times
+  double weight = 0;
+  l.time = 0;
+  for (size_t i = mass.left_bin; i < mass.right_bin; i++) {
+    double a = std::abs(spectrum[i].value);
+    l.time += a * (spectrum[i].time_reassigned - spectrum[i].time);
+    weight += a;
+  }
+  if (weight > 0) l.time /= weight;
+
+  return l;
+}
+
+// log(sum(exp(x))) over a contiguous row
+double log_sum_exp(const double * x, size_t n) {
+  double max = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < n; i++) {
+    max = std::max(max, x[i]);
+  }
+  if (std::isinf(max)) return max;
+
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += std::exp(x[i] - max);
+  }
+  return max + std::log(sum);
+}
+
+}
+
+std::vector<std::tuple<size_t, size_t, double>> audio_transport::monotone_solver::solve(
+    const std::vector<spectral_mass> & left,
+    const std::vector<spectral_mass> & right,
+    const std::vector<spectral::point> &,
+    const std::vector<spectral::point> &) const {
+  return transport_matrix(left, right);
+}
+
+audio_transport::sinkhorn_solver::sinkhorn_solver(options opts) :
+  opts(opts) {}
+
+std::vector<std::tuple<size_t, size_t, double>> audio_transport::sinkhorn_solver::solve(
+    const std::vector<spectral_mass> & left,
+    const std::vector<spectral_mass> & right,
+    const std::vector<spectral::point> & left_spectrum,
+    const std::vector<spectral::point> & right_spectrum) const {
+
+  // Only masses with some weight take part
+  std::vector<size_t> left_index, right_index;
+  for (size_t i = 0; i < left.size(); i++) {
+    if (left[i].mass > 0) left_index.push_back(i);
+  }
+  for (size_t j = 0; j < right.size(); j++) {
+    if (right[j].mass > 0) right_index.push_back(j);
+  }
+  size_t n = left_index.size();
+  size_t m = right_index.size();
+
+  // Stay within the budget
+  if (n == 0 or m == 0 or n * m > opts.max_cost_entries) {
+    return fallback.solve(left, right, left_spectrum, right_spectrum);
+  }
+
+  std::vector<location> left_locations(n), right_locations(m);
+  std::vector<double> log_a(n), log_b(m);
+  for (size_t i = 0; i < n; i++) {
+    left_locations[i] = locate(left[left_index[i]], left_spectrum);
+    log_a[i] = std::log(left[left_index[i]].mass);
+  }
+  for (size_t j = 0; j < m; j++) {
+    right_locations[j] = locate(right[right_index[j]], right_spectrum);
+    log_b[j] = std::log(right[right_index[j]].mass);
+  }
+
+  // The kernel -C/epsilon and its transpose so that
+  // both half-iterations stream through contiguous rows
+  std::vector<double> K(n * m), K_t(m * n);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < m; j++) {
+      double df = left_locations[i].freq - right_locations[j].freq;
+      double dt = (left_locations[i].time - right_locations[j].time)/opts.time_scale;
+      double cost = df * df + opts.time_weight * dt * dt;
+      K[i * m + j] = K_t[j * n + i] = -cost/opts.epsilon;
+    }
+  }
+
+  // Log-domain Sinkhorn iterations on the dual potentials
+  std::vector<double> u(n, 0), v(m, 0), row(std::max(n, m));
+  for (size_t iteration = 0; iteration < opts.max_iterations; iteration++) {
+    for (size_t i = 0; i < n; i++) {
+      const double * k = K.data() + i * m;
+      for (size_t j = 0; j < m; j++) row[j] = k[j] + v[j];
+      u[i] = log_a[i] - log_sum_exp(row.data(), m);
+    }
+    for (size_t j = 0; j < m; j++) {
+      const double * k = K_t.data() + j * n;
+      for (size_t i = 0; i < n; i++) row[i] = k[i] + u[i];
+      v[j] = log_b[j] - log_sum_exp(row.data(), n);
+    }
+
+    // The right marginal is now exact
+    // so check the left one every so often
+    if (iteration % 10 != 9) continue;
+    double error = 0;
+    for (size_t i = 0; i < n; i++) {
+      const double * k = K.data() + i * m;
+      for (size_t j = 0; j < m; j++) row[j] = k[j] + v[j];
+      error += std::abs(std::exp(u[i] + log_sum_exp(row.data(), m)) - std::exp(log_a[i]));
+    }
+    if (error < opts.tolerance) break;
+  }
+
+  // Read off the significant entries of the plan
+  std::vector<std::tuple<size_t, size_t, double>> T;
+  for (size_t i = 0; i < n; i++) {
+    const double * k = K.data() + i * m;
+    for (size_t j = 0; j < m; j++) {
+      double mass = std::exp(k[j] + u[i] + v[j]);
+      if (mass >= opts.min_mass) {
+        T.emplace_back(left_index[i], right_index[j], mass);
+      }
+    }
+  }
+
+  if (T.empty()) {
+    return fallback.solve(left, right, left_spectrum, right_spectrum);
+  }
+
+  return T;
+}